@@ -0,0 +1,115 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Agc.hpp"
+#include <algorithm>
+#include <cmath>
+
+//samples per gain update
+#define AGC_BLOCK 64
+//partial sums of the power estimate, two AVX registers
+#define AGC_LANES 16
+//limits of the gain
+#define AGC_MIN_GAIN -20.0f
+#define AGC_MAX_GAIN 60.0f
+
+BlockAgc::BlockAgc(void):
+    _reference(0.0),
+    _attackTime(0.0),
+    _decayTime(0.0),
+    _rate(0.0),
+    _attack(1.0f),
+    _decay(1.0f),
+    _gainDb(0.0f)
+{
+    return;
+}
+
+void BlockAgc::configure(const double reference, const double attack, const double decay, const double rate)
+{
+    if (reference == _reference and attack == _attackTime and decay == _decayTime and rate == _rate) return;
+    _reference = reference;
+    _attackTime = attack;
+    _decayTime = decay;
+    _rate = rate;
+
+    //one pole smoothing per block, a zero time constant follows at once
+    const double blockTime = AGC_BLOCK/rate;
+    _attack = (attack > 0.0)? float(1.0 - std::exp(-blockTime/attack)) : 1.0f;
+    _decay = (decay > 0.0)? float(1.0 - std::exp(-blockTime/decay)) : 1.0f;
+}
+
+void BlockAgc::reset(void)
+{
+    _gainDb.store(0.0f, std::memory_order_relaxed);
+}
+
+float BlockAgc::gainDb(void) const
+{
+    return _gainDb.load(std::memory_order_relaxed);
+}
+
+void BlockAgc::process(std::complex<float> *buff, const size_t numElems)
+{
+    float *x = reinterpret_cast<float *>(buff);
+    float gainDb = _gainDb.load(std::memory_order_relaxed);
+    float g0 = std::pow(10.0f, gainDb/20);
+
+    for (size_t i = 0; i < numElems; i += AGC_BLOCK)
+    {
+        const size_t n = std::min<size_t>(AGC_BLOCK, numElems - i);
+        float *w = x + 2*i;
+
+        //mean power of the block before the gain
+        float acc[AGC_LANES] = {};
+        size_t j = 0;
+        for (; j + AGC_LANES <= 2*n; j += AGC_LANES)
+        {
+            for (size_t l = 0; l < AGC_LANES; l++) acc[l] += w[j+l]*w[j+l];
+        }
+        for (; j < 2*n; j++) acc[0] += w[j]*w[j];
+        float power = 0.0f;
+        for (size_t l = 0; l < AGC_LANES; l++) power += acc[l];
+        power /= n;
+
+        //move towards the reference, quickly when the level is too high
+        const float levelDb = 10*std::log10(power + 1e-20f) + gainDb;
+        const float error = float(_reference) - levelDb;
+        gainDb += ((error < 0.0f)? _attack : _decay)*error;
+        gainDb = std::max(AGC_MIN_GAIN, std::min(AGC_MAX_GAIN, gainDb));
+
+        //ramp from the previous gain to the new one
+        const float g1 = std::pow(10.0f, gainDb/20);
+        const float dg = (g1 - g0)/n;
+        for (int k = 0; k < int(n); k++)
+        {
+            const float g = g0 + dg*(k + 1);
+            w[2*k+0] *= g;
+            w[2*k+1] *= g;
+        }
+        g0 = g1;
+    }
+
+    _gainDb.store(gainDb, std::memory_order_relaxed);
+}
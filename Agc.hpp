@@ -0,0 +1,59 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <complex>
+#include <atomic>
+#include <cstddef>
+
+/*!
+ * Block based automatic gain control.
+ * The power of each block sets a new gain in dB, smoothed with the
+ * attack time when the level is above the reference and with the
+ * decay time below it. The gain is ramped linearly across the block
+ * so there are no steps at block edges.
+ */
+class BlockAgc
+{
+public:
+    BlockAgc(void);
+
+    //! Reference level in dBFS, attack and decay time constants in seconds
+    void configure(const double reference, const double attack, const double decay, const double rate);
+
+    //! Return to unity gain
+    void reset(void);
+
+    //! Apply the gain to numElems samples in place
+    void process(std::complex<float> *buff, const size_t numElems);
+
+    //! Current gain in dB, safe to call from any thread
+    float gainDb(void) const;
+
+private:
+    double _reference, _attackTime, _decayTime, _rate;
+    float _attack, _decay;
+    std::atomic<float> _gainDb;
+};
@@ -0,0 +1,114 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/*!
+ * Bounded lock-free queue for several producers and consumers.
+ * Every slot carries a sequence number that tells whose turn it is,
+ * so push and pop only contend on one atomic position each.
+ * The capacity is rounded up to a power of two, and a push to a full
+ * queue fails instead of blocking.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(const size_t capacity):
+        _mask(0),
+        _push(0),
+        _pop(0)
+    {
+        size_t size = 1;
+        while (size < capacity) size *= 2;
+        _mask = size - 1;
+        _slots = std::vector<Slot>(size);
+        for (size_t i = 0; i < size; i++) _slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const T &value)
+    {
+        size_t pos = _push.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = _slots[pos & _mask];
+            const size_t seq = slot.seq.load(std::memory_order_acquire);
+            const long diff = long(seq) - long(pos);
+            if (diff == 0)
+            {
+                if (_push.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) return false; //full
+            else pos = _push.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool pop(T &value)
+    {
+        size_t pos = _pop.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = _slots[pos & _mask];
+            const size_t seq = slot.seq.load(std::memory_order_acquire);
+            const long diff = long(seq) - long(pos + 1);
+            if (diff == 0)
+            {
+                if (_pop.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = slot.value;
+                    slot.seq.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) return false; //empty
+            else pos = _pop.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool empty(void) const
+    {
+        const size_t pos = _pop.load(std::memory_order_relaxed);
+        return _slots[pos & _mask].seq.load(std::memory_order_acquire) != pos + 1;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    size_t _mask;
+    std::vector<Slot> _slots;
+    std::atomic<size_t> _push, _pop;
+};
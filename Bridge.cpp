@@ -0,0 +1,389 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "Bridge.hpp"
+#include <SoapySDR/Logger.hpp>
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#ifdef __linux__
+#include <sys/un.h>
+#include <linux/errqueue.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+SocketBridge::SocketBridge(const size_t frameElems, const size_t batch, const size_t depth):
+    _frameElems(std::max<size_t>(frameElems, 1)),
+    _batch(std::max<size_t>(batch, 1)),
+    _depth(std::max(depth, _batch)),
+    _fd(-1),
+    _conn(-1),
+    _listening(false),
+    _zeroCopy(false),
+    _timeoutMs(100),
+    _zcSent(0),
+    _zcDone(0),
+    _queued(0),
+    _numFrames(0),
+    _numSyscalls(0),
+    _numDropped(0)
+{
+#ifdef __linux__
+    _msgs.resize(_batch);
+    _iovs.resize(_batch);
+#endif
+}
+
+SocketBridge::~SocketBridge(void)
+{
+#ifdef __linux__
+    if (_zeroCopy) this->reapZeroCopy();
+    if (_conn >= 0 and _conn != _fd) close(_conn);
+    if (_fd >= 0) close(_fd);
+    if (_listening) unlink(_path.c_str());
+#endif
+}
+
+#ifdef __linux__
+static sockaddr_un bridgeAddress(const std::string &path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() or path.size() >= sizeof(addr.sun_path))
+    {
+        throw std::runtime_error("SocketBridge: bad socket path " + path);
+    }
+    std::strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+#endif
+
+void SocketBridge::connect(const std::string &path, const bool datagram, const bool zeroCopy)
+{
+#ifdef __linux__
+    const auto addr = bridgeAddress(path);
+    _fd = socket(AF_UNIX, (datagram ? SOCK_DGRAM : SOCK_SEQPACKET) | SOCK_CLOEXEC, 0);
+    if (_fd < 0) throw std::runtime_error("SocketBridge: socket() " + std::string(std::strerror(errno)));
+    if (::connect(_fd, (const sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        throw std::runtime_error("SocketBridge: connect(" + path + ") " + std::string(std::strerror(errno)));
+    }
+
+    //the kernel only pins pages for some socket families,
+    //the others keep copying, which is the same thing but slower
+    if (zeroCopy)
+    {
+        const int one = 1;
+        _zeroCopy = setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+        if (not _zeroCopy) SoapySDR_logf(SOAPY_SDR_WARNING,
+            "SocketBridge: no MSG_ZEROCOPY on this socket (%s), sending copies", std::strerror(errno));
+    }
+
+    //the send queue is sized once for its whole depth
+    _frames.resize(_depth, std::vector<char>(sizeof(BridgeHeader) + _frameElems*sizeof(std::complex<float>)));
+    _lengths.resize(_depth);
+#else
+    throw std::runtime_error("SocketBridge: unix socket bridge not supported on this platform");
+#endif
+}
+
+void SocketBridge::bind(const std::string &path, const bool datagram, const int timeoutMs)
+{
+#ifdef __linux__
+    const auto addr = bridgeAddress(path);
+    _fd = socket(AF_UNIX, (datagram ? SOCK_DGRAM : SOCK_SEQPACKET) | SOCK_CLOEXEC, 0);
+    if (_fd < 0) throw std::runtime_error("SocketBridge: socket() " + std::string(std::strerror(errno)));
+
+    //a stale socket file from an earlier run would fail the bind
+    unlink(path.c_str());
+    if (::bind(_fd, (const sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        throw std::runtime_error("SocketBridge: bind(" + path + ") " + std::string(std::strerror(errno)));
+    }
+    _path = path;
+    _listening = true;
+    _timeoutMs = timeoutMs;
+
+    if (datagram) _conn = _fd;
+    else if (listen(_fd, 1) != 0)
+    {
+        throw std::runtime_error("SocketBridge: listen(" + path + ") " + std::string(std::strerror(errno)));
+    }
+
+    //the receive buffers are sized once for a whole batch
+    _frames.resize(_batch, std::vector<char>(sizeof(BridgeHeader) + _frameElems*sizeof(std::complex<float>)));
+    _lengths.resize(_batch);
+#else
+    throw std::runtime_error("SocketBridge: unix socket bridge not supported on this platform");
+#endif
+}
+
+void SocketBridge::queue(const long long tick, const std::complex<float> *samples, const size_t numElems)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t i = 0;
+    while (i < numElems)
+    {
+        //samples that follow on from the last frame fill it up first,
+        //the first frames of the batch may still be pinned by the kernel
+        BridgeHeader *hdr = nullptr;
+        if (_queued != 0)
+        {
+            hdr = reinterpret_cast<BridgeHeader *>(_frames[_queued-1].data());
+            if (hdr->numElems == _frameElems or hdr->tick + hdr->numElems != tick + (long long)i) hdr = nullptr;
+        }
+        if (hdr == nullptr)
+        {
+            //a full queue makes room with what the receiver takes now,
+            //failing that the oldest frame goes so the newest go out
+            if (_queued == _frames.size()) this->send((_queued/_batch)*_batch, 0);
+            if (_queued == _frames.size())
+            {
+                for (size_t j = 1; j < _queued; j++)
+                {
+                    std::swap(_frames[j-1], _frames[j]);
+                    std::swap(_lengths[j-1], _lengths[j]);
+                }
+                _queued--;
+                _numDropped++;
+            }
+            hdr = reinterpret_cast<BridgeHeader *>(_frames[_queued++].data());
+            hdr->magic = BRIDGE_MAGIC;
+            hdr->numElems = 0;
+            hdr->tick = tick + i;
+        }
+
+        const size_t n = std::min(numElems - i, _frameElems - hdr->numElems);
+        auto out = reinterpret_cast<std::complex<float> *>(hdr + 1) + hdr->numElems;
+        std::memcpy(out, samples + i, n*sizeof(std::complex<float>));
+        hdr->numElems += n;
+        _lengths[_queued-1] = sizeof(BridgeHeader) + hdr->numElems*sizeof(std::complex<float>);
+        i += n;
+    }
+}
+
+bool SocketBridge::flush(const bool force, const long timeoutUs)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    //the last frame stays back until it is full unless forced
+    return this->send(force ? _queued : (_queued/_batch)*_batch, timeoutUs);
+}
+
+bool SocketBridge::send(const size_t numSend, const long timeoutUs)
+{
+#ifdef __linux__
+    //under the lock
+    if (numSend == 0) return true;
+
+    //a full receiver is waited on for what is left of the timeout
+    const auto exitTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(timeoutUs);
+    const int flags = MSG_NOSIGNAL | MSG_DONTWAIT | (_zeroCopy ? MSG_ZEROCOPY : 0);
+    bool ok = true;
+    size_t sent = 0;
+    while (sent < numSend)
+    {
+        const size_t n = std::min(_batch, numSend - sent);
+        for (size_t j = 0; j < n; j++)
+        {
+            _iovs[j].iov_base = _frames[sent+j].data();
+            _iovs[j].iov_len = _lengths[sent+j];
+            std::memset(&_msgs[j], 0, sizeof(mmsghdr));
+            _msgs[j].msg_hdr.msg_iov = &_iovs[j];
+            _msgs[j].msg_hdr.msg_iovlen = 1;
+        }
+        const int ret = sendmmsg(_fd, _msgs.data(), n, flags);
+        _numSyscalls++;
+        if (ret < 0 and errno == EINTR) continue;
+        if (ret < 0 and (errno == EAGAIN or errno == EWOULDBLOCK))
+        {
+            //the frames not sent in time stay queued for the next flush
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                exitTime - std::chrono::high_resolution_clock::now()).count();
+            pollfd pfd = {_fd, POLLOUT, 0};
+            if (left > 0 and poll(&pfd, 1, int(left)) > 0) continue;
+            ok = false;
+            break;
+        }
+        if (ret < 0)
+        {
+            //the receiver went away, the frames are lost
+            _numDropped += numSend - sent;
+            sent = numSend;
+            ok = false;
+            break;
+        }
+        if (_zeroCopy) _zcSent += ret;
+        _numFrames += ret;
+        sent += ret;
+    }
+
+    //pinned pages must be released before the frames are written again
+    if (_zeroCopy) this->reapZeroCopy();
+
+    //move the frames that stay back to the front
+    for (size_t j = 0; j + sent < _queued; j++)
+    {
+        std::swap(_frames[j], _frames[j + sent]);
+        std::swap(_lengths[j], _lengths[j + sent]);
+    }
+    _queued -= sent;
+    return ok;
+#else
+    return false;
+#endif
+}
+
+void SocketBridge::reapZeroCopy(void)
+{
+#ifdef __linux__
+    //each notification acknowledges a range of send calls
+    char control[128];
+    while (_zcDone < _zcSent)
+    {
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(_fd, &msg, MSG_ERRQUEUE) < 0)
+        {
+            if (errno != EAGAIN and errno != EINTR) break;
+            pollfd pfd = {_fd, 0, 0};
+            if (poll(&pfd, 1, 100) <= 0) break;
+            continue;
+        }
+        for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            const auto err = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cm));
+            if (err->ee_errno != 0 or err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            _zcDone += err->ee_data - err->ee_info + 1;
+        }
+    }
+#endif
+}
+
+bool SocketBridge::accept(void)
+{
+#ifdef __linux__
+    pollfd pfd = {_fd, POLLIN, 0};
+    if (poll(&pfd, 1, _timeoutMs) <= 0) return false;
+    _conn = ::accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (_conn < 0) return false;
+
+    //receives wake up on their own to check for shutdown
+    timeval tv;
+    tv.tv_sec = _timeoutMs/1000;
+    tv.tv_usec = (_timeoutMs%1000)*1000;
+    setsockopt(_conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t SocketBridge::receive(void)
+{
+#ifdef __linux__
+    if (_conn < 0 and not this->accept()) return 0;
+
+    //the datagram socket has no accept to set the timeout
+    pollfd pfd = {_conn, POLLIN, 0};
+    if (_conn == _fd and poll(&pfd, 1, _timeoutMs) <= 0) return 0;
+
+    for (size_t j = 0; j < _batch; j++)
+    {
+        _iovs[j].iov_base = _frames[j].data();
+        _iovs[j].iov_len = _frames[j].size();
+        std::memset(&_msgs[j], 0, sizeof(mmsghdr));
+        _msgs[j].msg_hdr.msg_iov = &_iovs[j];
+        _msgs[j].msg_hdr.msg_iovlen = 1;
+    }
+
+    //wait for the first frame, then take whatever else is already queued
+    const int ret = recvmmsg(_conn, _msgs.data(), _batch, MSG_WAITFORONE, nullptr);
+    _numSyscalls++;
+    if (ret <= 0)
+    {
+        //an empty read is the sender hanging up, wait for the next one
+        if (ret == 0 or (errno != EAGAIN and errno != EINTR))
+        {
+            if (_conn != _fd) close(_conn);
+            if (_conn != _fd) _conn = -1;
+        }
+        return 0;
+    }
+
+    //malformed frames are dropped by compacting the good ones to the front
+    size_t numGood = 0;
+    for (int j = 0; j < ret; j++)
+    {
+        const size_t len = _msgs[j].msg_len;
+        const auto hdr = reinterpret_cast<const BridgeHeader *>(_frames[j].data());
+        const bool good = (_msgs[j].msg_hdr.msg_flags & MSG_TRUNC) == 0 and
+            len >= sizeof(BridgeHeader) and hdr->magic == BRIDGE_MAGIC and
+            len == sizeof(BridgeHeader) + hdr->numElems*sizeof(std::complex<float>);
+        if (not good) _numDropped++;
+        else std::swap(_frames[numGood++], _frames[j]);
+    }
+    _numFrames += numGood;
+    return numGood;
+#else
+    return 0;
+#endif
+}
+
+const BridgeHeader &SocketBridge::header(const size_t index) const
+{
+    return *reinterpret_cast<const BridgeHeader *>(_frames[index].data());
+}
+
+const std::complex<float> *SocketBridge::samples(const size_t index) const
+{
+    return reinterpret_cast<const std::complex<float> *>(_frames[index].data() + sizeof(BridgeHeader));
+}
+
+unsigned long long SocketBridge::frames(void) const
+{
+    return _numFrames;
+}
+
+unsigned long long SocketBridge::syscalls(void) const
+{
+    return _numSyscalls;
+}
+
+unsigned long long SocketBridge::dropped(void) const
+{
+    return _numDropped;
+}
+
+void SocketBridge::drop(void)
+{
+    _numDropped++;
+}
@@ -0,0 +1,118 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <complex>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+//! Header in front of the samples of every bridge frame
+struct BridgeHeader
+{
+    uint32_t magic;
+    uint32_t numElems; //complex floats after the header
+    int64_t tick; //sender tick of the first sample
+};
+
+#define BRIDGE_MAGIC 0x4c4f4f50
+
+/*!
+ * Carries transmit samples to another process over an AF_UNIX socket,
+ * one tick stamped frame per datagram. Frames are queued and go out a
+ * batch at a time with sendmmsg, and come in a batch at a time with
+ * recvmmsg, so the frame and batch sizes set the syscalls per sample.
+ * SOCK_SEQPACKET keeps a connection to one sender, SOCK_DGRAM takes
+ * frames from whoever sends them. The sender queues up to depth frames,
+ * allocated once, and drops the oldest when a stalled receiver leaves
+ * no room. Linux only, elsewhere it throws.
+ */
+class SocketBridge
+{
+public:
+    SocketBridge(const size_t frameElems, const size_t batch, const size_t depth);
+    ~SocketBridge(void);
+
+    //! Send to the receiver bound on path, MSG_ZEROCOPY when the socket allows it
+    void connect(const std::string &path, const bool datagram, const bool zeroCopy);
+
+    //! Bind path to receive, each receive waits up to timeoutMs
+    void bind(const std::string &path, const bool datagram, const int timeoutMs);
+
+    //! Queue samples from tick on, filling up the last frame when they follow it,
+    //! a full queue sends its whole batches without waiting or drops its oldest frame
+    void queue(const long long tick, const std::complex<float> *samples, const size_t numElems);
+
+    //! Send the whole batches, or everything queued when forced,
+    //! what the receiver has no room for within timeoutUs stays queued
+    bool flush(const bool force, const long timeoutUs);
+
+    //! Receive up to a batch of frames, which stay valid until the next call
+    size_t receive(void);
+    const BridgeHeader &header(const size_t index) const;
+    const std::complex<float> *samples(const size_t index) const;
+
+    //! Frames moved, send or receive calls made, and frames that were malformed or dropped
+    unsigned long long frames(void) const;
+    unsigned long long syscalls(void) const;
+    unsigned long long dropped(void) const;
+    void drop(void);
+
+private:
+    SocketBridge(const SocketBridge &);
+    SocketBridge &operator=(const SocketBridge &);
+
+    bool accept(void);
+    bool send(const size_t numSend, const long timeoutUs);
+    void reapZeroCopy(void);
+
+    const size_t _frameElems, _batch, _depth;
+    int _fd, _conn;
+    std::string _path;
+    bool _listening, _zeroCopy;
+    int _timeoutMs;
+    unsigned long long _zcSent, _zcDone;
+
+    //frames are header plus samples, the first _queued are in use;
+    //queue and flush come from the stream calls of different threads
+    std::mutex _mutex;
+    std::vector<std::vector<char> > _frames;
+    std::vector<size_t> _lengths;
+    size_t _queued;
+
+    //the message headers of one batch, sized once
+#ifdef __linux__
+    std::vector<mmsghdr> _msgs;
+    std::vector<iovec> _iovs;
+#endif
+
+    std::atomic<unsigned long long> _numFrames, _numSyscalls, _numDropped;
+};
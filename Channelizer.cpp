@@ -0,0 +1,138 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "Channelizer.hpp"
+#include "Decimator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+PolyphaseChannelizer::PolyphaseChannelizer(void):
+    _numChans(0),
+    _numTaps(0)
+{
+    return;
+}
+
+size_t PolyphaseChannelizer::numChannels(void) const
+{
+    return _numChans;
+}
+
+void PolyphaseChannelizer::configure(const size_t numChans)
+{
+    _numChans = numChans;
+    const size_t N = _numChans;
+
+    //prototype low pass one channel wide, -6 dB at the channel edges,
+    //padded to whole branches
+    auto proto = FirDecimator::design(0.5/N, 0.25/N);
+    _numTaps = (proto.size() + N - 1)/N;
+    proto.resize(N*_numTaps, 0.0f);
+
+    //branch-major taps, reversed within the block and duplicated for
+    //interleaved I/Q: block q holds h[N-1-p + qN] at lane p
+    _taps.resize(2*N*_numTaps);
+    for (size_t q = 0; q < _numTaps; q++)
+    {
+        for (size_t p = 0; p < N; p++)
+        {
+            const float h = proto[N-1-p + q*N];
+            _taps[2*(q*N + p)+0] = h;
+            _taps[2*(q*N + p)+1] = h;
+        }
+    }
+
+    _work.assign(N*(_numTaps - 1), std::complex<float>(0.0f));
+    _branches.resize(N);
+
+    //radix-2 tables for the inverse transform
+    _twiddles.resize(N/2);
+    for (size_t k = 0; k < N/2; k++) _twiddles[k] = std::polar(1.0f, float(2*M_PI*k/N));
+    _bitrev.resize(N);
+    size_t bits = 0;
+    while ((size_t(1) << bits) < N) bits++;
+    for (size_t i = 0; i < N; i++)
+    {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; b++) if (i & (size_t(1) << b)) r |= size_t(1) << (bits - 1 - b);
+        _bitrev[i] = r;
+    }
+}
+
+void PolyphaseChannelizer::fft(std::complex<float> *x) const
+{
+    const size_t N = _numChans;
+    for (size_t i = 0; i < N; i++)
+    {
+        if (i < _bitrev[i]) std::swap(x[i], x[_bitrev[i]]);
+    }
+    for (size_t len = 2; len <= N; len <<= 1)
+    {
+        const size_t stride = N/len;
+        for (size_t i = 0; i < N; i += len)
+        {
+            for (size_t j = 0; j < len/2; j++)
+            {
+                const std::complex<float> t = _twiddles[j*stride]*x[i + j + len/2];
+                x[i + j + len/2] = x[i + j] - t;
+                x[i + j] += t;
+            }
+        }
+    }
+}
+
+void PolyphaseChannelizer::process(const std::complex<float> *in, std::complex<float> * const *outs, const size_t numOut)
+{
+    const size_t N = _numChans;
+    const size_t history = N*(_numTaps - 1);
+
+    //history followed by the new input
+    _work.resize(history + numOut*N);
+    std::memcpy(_work.data() + history, in, numOut*N*sizeof(std::complex<float>));
+
+    float *v = reinterpret_cast<float *>(_branches.data());
+    for (size_t m = 0; m < numOut; m++)
+    {
+        //branch p sums h[p + qN]*x[(m-q)N + N-1 - p], so lane N-1-p of
+        //the reversed taps reads ascending samples and the loop vectorizes
+        std::fill(_branches.begin(), _branches.end(), std::complex<float>(0.0f));
+        for (size_t q = 0; q < _numTaps; q++)
+        {
+            const float *h = _taps.data() + 2*q*N;
+            const float *x = reinterpret_cast<const float *>(_work.data() + history + m*N - q*N);
+            for (size_t f = 0; f < 2*N; f++) v[f] += h[f]*x[f];
+        }
+
+        //lane p holds branch N-1-p, restore branch order for the transform
+        std::reverse(_branches.begin(), _branches.end());
+        this->fft(_branches.data());
+        for (size_t k = 0; k < N; k++) outs[k][m] = _branches[k];
+    }
+
+    //keep the tail as history
+    std::memmove(_work.data(), _work.data() + numOut*N, history*sizeof(std::complex<float>));
+    _work.resize(history);
+}
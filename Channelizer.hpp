@@ -0,0 +1,59 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <complex>
+#include <vector>
+#include <cstddef>
+
+/*!
+ * Critically sampled polyphase filter bank channelizer.
+ * A wideband input at numChans times the channel rate is split into
+ * numChans adjacent channels: the polyphase branches filter one block
+ * of numChans inputs and an FFT across the branches produces one
+ * output sample per channel, channel k centered at k/numChans of the
+ * wideband rate in FFT order.
+ */
+class PolyphaseChannelizer
+{
+public:
+    PolyphaseChannelizer(void);
+
+    //! Design the prototype filter for a power of two channel count
+    void configure(const size_t numChans);
+
+    size_t numChannels(void) const;
+
+    //! Produce numOut samples per channel from numOut*numChans inputs
+    void process(const std::complex<float> *in, std::complex<float> * const *outs, const size_t numOut);
+
+private:
+    void fft(std::complex<float> *x) const;
+
+    size_t _numChans, _numTaps;
+    std::vector<float> _taps;
+    std::vector<std::complex<float> > _work, _branches, _twiddles;
+    std::vector<size_t> _bitrev;
+};
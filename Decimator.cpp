@@ -0,0 +1,130 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "Decimator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//partial sums per output, two AVX registers of interleaved I/Q
+#define FIR_LANES 16
+
+//modified bessel function of the first kind, order zero
+static double besselI0(const double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x/(2*k))*(x/(2*k));
+        sum += term;
+        if (term < sum*1e-12) break;
+    }
+    return sum;
+}
+
+FirDecimator::FirDecimator(void):
+    _decim(1),
+    _numTaps(0)
+{
+    return;
+}
+
+std::vector<float> FirDecimator::design(const double cutoff, const double transition, const double attenuation)
+{
+    const double beta = (attenuation > 50)? 0.1102*(attenuation - 8.7) :
+        0.5842*std::pow(attenuation - 21, 0.4) + 0.07886*(attenuation - 21);
+    const size_t numTaps = size_t(std::ceil((attenuation - 8)/(2.285*2*M_PI*transition))) | 1;
+
+    std::vector<float> taps(numTaps);
+    const double mid = (numTaps - 1)/2.0;
+    double sum = 0.0;
+    for (size_t n = 0; n < numTaps; n++)
+    {
+        const double t = n - mid;
+        const double sinc = (t == 0.0)? 2*cutoff : std::sin(2*M_PI*cutoff*t)/(M_PI*t);
+        const double r = t/mid;
+        const double window = besselI0(beta*std::sqrt(std::max(0.0, 1 - r*r)))/besselI0(beta);
+        taps[n] = float(sinc*window);
+        sum += taps[n];
+    }
+    for (auto &tap : taps) tap = float(tap/sum);
+    return taps;
+}
+
+void FirDecimator::configure(const std::vector<float> &taps, const size_t decim)
+{
+    _decim = std::max<size_t>(decim, 1);
+    _numTaps = taps.size();
+    if (_numTaps == 0) return this->configure(std::vector<float>(1, 1.0f), decim);
+
+    //reversed and duplicated for interleaved I/Q, padded to whole lanes
+    const size_t length = ((2*_numTaps + FIR_LANES - 1)/FIR_LANES)*FIR_LANES;
+    _taps.assign(length, 0.0f);
+    for (size_t n = 0; n < _numTaps; n++)
+    {
+        _taps[2*n+0] = taps[_numTaps - 1 - n];
+        _taps[2*n+1] = taps[_numTaps - 1 - n];
+    }
+
+    _work.assign(_numTaps - 1, std::complex<float>(0.0f));
+}
+
+void FirDecimator::process(const std::complex<float> *in, std::complex<float> *out, const size_t numOut)
+{
+    const size_t history = _numTaps - 1;
+    const size_t numIn = numOut*_decim;
+
+    //history followed by the new input, then zeros for the padded
+    //lanes that the last window reads past the newest sample
+    _work.resize(history + numIn);
+    std::memcpy(_work.data() + history, in, numIn*sizeof(std::complex<float>));
+    _work.resize(history + numIn + _taps.size()/2 - _numTaps, std::complex<float>(0.0f));
+
+    //output m ends on sample history + (m+1)*decim - 1
+    const float *x = reinterpret_cast<const float *>(_work.data());
+    const float *h = _taps.data();
+    const size_t length = _taps.size();
+    const size_t first = _decim - 1;
+    for (size_t m = 0; m < numOut; m++)
+    {
+        const float *w = x + 2*(first + m*_decim);
+        float acc[FIR_LANES] = {};
+        for (size_t f = 0; f < length; f += FIR_LANES)
+        {
+            for (size_t j = 0; j < FIR_LANES; j++) acc[j] += h[f+j]*w[f+j];
+        }
+        float re = 0.0f, im = 0.0f;
+        for (size_t j = 0; j < FIR_LANES; j += 2)
+        {
+            re += acc[j+0];
+            im += acc[j+1];
+        }
+        out[m] = std::complex<float>(re, im);
+    }
+
+    //keep the tail as history
+    std::memmove(_work.data(), _work.data() + numIn, history*sizeof(std::complex<float>));
+    _work.resize(history);
+}
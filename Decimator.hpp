@@ -0,0 +1,58 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <complex>
+#include <vector>
+#include <cstddef>
+
+/*!
+ * FIR low pass filter that decimates by an integer factor.
+ * Only every decim-th output of the full rate filter is computed,
+ * which costs the same as the polyphase form with contiguous loads.
+ */
+class FirDecimator
+{
+public:
+    FirDecimator(void);
+
+    //! Load new taps and decimation, the history is cleared
+    void configure(const std::vector<float> &taps, const size_t decim);
+
+    //! Produce numOut samples from numOut*decim inputs, in may equal out
+    void process(const std::complex<float> *in, std::complex<float> *out, const size_t numOut);
+
+    /*!
+     * Kaiser windowed sinc low pass with unity gain at DC.
+     * The cutoff (-6 dB) and transition width are normalized to the
+     * input rate, the length follows from the stopband attenuation.
+     */
+    static std::vector<float> design(const double cutoff, const double transition, const double attenuation = 80.0);
+
+private:
+    size_t _decim, _numTaps;
+    std::vector<float> _taps;
+    std::vector<std::complex<float> > _work;
+};
@@ -0,0 +1,120 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Delay.hpp"
+#include <algorithm>
+
+//out (+)= gain*in, complex samples
+static void mixPath(float *out, const float *in, const int numElems, const std::complex<float> gain, const bool accumulate)
+{
+    const float gr = gain.real(), gi = gain.imag();
+    if (accumulate) for (int k = 0; k < numElems; k++)
+    {
+        out[2*k+0] += gr*in[2*k+0] - gi*in[2*k+1];
+        out[2*k+1] += gr*in[2*k+1] + gi*in[2*k+0];
+    }
+    else for (int k = 0; k < numElems; k++)
+    {
+        out[2*k+0] = gr*in[2*k+0] - gi*in[2*k+1];
+        out[2*k+1] = gr*in[2*k+1] + gi*in[2*k+0];
+    }
+}
+
+MultipathDelayLine::MultipathDelayLine(void):
+    _mask(0),
+    _history(0),
+    _read(0)
+{
+    _taps.push_back(DelayTap{0, 1.0f});
+}
+
+void MultipathDelayLine::reset(const size_t length, const long long tick)
+{
+    _buff.assign(length, std::complex<float>(0.0f));
+    _mask = length - 1;
+    _read = tick;
+}
+
+void MultipathDelayLine::setTaps(const std::vector<DelayTap> &taps)
+{
+    _taps = taps;
+    _history = 0;
+    for (const auto &tap : _taps) _history = std::max(_history, tap.delay);
+}
+
+long long MultipathDelayLine::readTick(void) const
+{
+    return _read;
+}
+
+long long MultipathDelayLine::writeLimit(void) const
+{
+    return _read - _history + _buff.size();
+}
+
+std::complex<float> *MultipathDelayLine::writeSpan(const long long tick, size_t &numElems)
+{
+    const size_t pos = size_t(tick) & _mask;
+    numElems = std::min(numElems, _buff.size() - pos);
+    return _buff.data() + pos;
+}
+
+void MultipathDelayLine::read(std::complex<float> *out, const size_t numElems)
+{
+    if (_buff.empty())
+    {
+        if (out != nullptr) std::fill(out, out + numElems, std::complex<float>(0.0f));
+        _read += numElems;
+        return;
+    }
+
+    //chunks of at most a quarter of the buffer, so that reading
+    //never runs into the region cleared behind it
+    const size_t chunk = _buff.size()/4;
+    for (size_t offset = 0; offset < numElems; offset += chunk)
+    {
+        const size_t n = std::min(chunk, numElems - offset);
+        if (out != nullptr) for (size_t j = 0; j < _taps.size(); j++)
+        {
+            for (size_t done = 0; done < n;)
+            {
+                const size_t pos = size_t(_read + done - _taps[j].delay) & _mask;
+                const size_t m = std::min(n - done, _buff.size() - pos);
+                mixPath(reinterpret_cast<float *>(out + offset + done),
+                    reinterpret_cast<const float *>(_buff.data() + pos), int(m), _taps[j].gain, j != 0);
+                done += m;
+            }
+        }
+
+        //no path reads behind the longest delay anymore
+        for (size_t done = 0; done < n;)
+        {
+            const size_t pos = size_t(_read + done - _history) & _mask;
+            const size_t m = std::min(n - done, _buff.size() - pos);
+            std::fill(_buff.begin() + pos, _buff.begin() + pos + m, std::complex<float>(0.0f));
+            done += m;
+        }
+        _read += n;
+    }
+}
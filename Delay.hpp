@@ -0,0 +1,73 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <complex>
+#include <vector>
+#include <cstddef>
+
+//! One propagation path: extra delay in samples and complex gain
+struct DelayTap
+{
+    size_t delay;
+    std::complex<float> gain;
+};
+
+/*!
+ * Circular buffer indexed by sample tick that sums several delayed
+ * paths on the way out. Writers store straight into the buffer at the
+ * tick they target and the reader walks forward one tick at a time,
+ * so samples are only touched once on either side. Storage that no
+ * path reads anymore is cleared for the next lap of the buffer.
+ */
+class MultipathDelayLine
+{
+public:
+    MultipathDelayLine(void);
+
+    //! Allocate length samples (a power of two), cleared, reading from tick
+    void reset(const size_t length, const long long tick);
+
+    //! Paths to sum, the longest delay must stay under half the length
+    void setTaps(const std::vector<DelayTap> &taps);
+
+    //! Next tick of the first path that read() returns
+    long long readTick(void) const;
+
+    //! Writes end before this tick, later storage is still being read
+    long long writeLimit(void) const;
+
+    //! Storage for samples from tick on, numElems is cut to what is contiguous
+    std::complex<float> *writeSpan(const long long tick, size_t &numElems);
+
+    //! Sum the paths into out (null to discard) and advance by numElems
+    void read(std::complex<float> *out, const size_t numElems);
+
+private:
+    std::vector<std::complex<float> > _buff;
+    std::vector<DelayTap> _taps;
+    size_t _mask, _history;
+    long long _read;
+};
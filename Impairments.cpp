@@ -0,0 +1,208 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SoapyLoopback.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+//samples between updates of the fading coefficient and noise offset
+#define IMPAIR_BLOCK 256
+//length of the precomputed noise table in complex samples
+#define NOISE_TABLE_LENGTH (1 << 16)
+//scattered paths in the sum of sinusoids fading model
+#define FADING_PATHS 16
+
+/*******************************************************************
+ * Fused impairment kernel
+ ******************************************************************/
+
+//Apply gain, fading, frequency offset, noise and IQ imbalance in a single pass.
+//The rotation comes from a table of e^(j*k*dphi) for one block turned
+//by the block start phase, and the fading coefficient is interpolated
+//linearly, so no value is carried from one sample to the next.
+//The noise of a block is a table span turned by a random phase.
+//The imbalanced Q branch is qa*Q + qb*I.
+static void fusedImpairment(
+    float *x,
+    const int numElems,
+    const std::complex<float> g0,
+    const std::complex<float> dg,
+    const std::complex<float> phasor,
+    const float *rotRe,
+    const float *rotIm,
+    const float *noise,
+    const std::complex<float> noiseRot,
+    const float qa,
+    const float qb)
+{
+    for (int k = 0; k < numElems; k++)
+    {
+        const float gr = g0.real() + dg.real()*k;
+        const float gi = g0.imag() + dg.imag()*k;
+        const float rr = phasor.real()*rotRe[k] - phasor.imag()*rotIm[k];
+        const float ri = phasor.real()*rotIm[k] + phasor.imag()*rotRe[k];
+        const float mr = gr*rr - gi*ri;
+        const float mi = gr*ri + gi*rr;
+        const float xr = x[2*k+0];
+        const float xi = x[2*k+1];
+        const float nr = noiseRot.real()*noise[2*k+0] - noiseRot.imag()*noise[2*k+1];
+        const float ni = noiseRot.real()*noise[2*k+1] + noiseRot.imag()*noise[2*k+0];
+        const float yr = xr*mr - xi*mi + nr;
+        const float yi = xr*mi + xi*mr + ni;
+        x[2*k+0] = yr;
+        x[2*k+1] = qa*yi + qb*yr;
+    }
+}
+
+/*******************************************************************
+ * Impairment stage
+ ******************************************************************/
+
+void SoapyLoopback::initImpairments(void)
+{
+    std::minstd_rand rng(_imp_rng);
+
+    //unit power complex gaussian noise, padded so that a block
+    //starting anywhere in the table can be read without wrapping
+    std::normal_distribution<float> gauss(0.0f, std::sqrt(0.5f));
+    _imp_noise.resize(2*(NOISE_TABLE_LENGTH + IMPAIR_BLOCK));
+    for (auto &v : _imp_noise) v = gauss(rng);
+
+    //Clarke model: arrival angles spread around the circle with random phases
+    std::uniform_real_distribution<double> uniform(0.0, 2*M_PI);
+    _imp_fade_freqs.resize(FADING_PATHS);
+    _imp_fade_phases.resize(FADING_PATHS);
+    for (size_t m = 0; m < FADING_PATHS; m++)
+    {
+        const double alpha = (2*M_PI*m + uniform(rng)/2)/FADING_PATHS;
+        _imp_fade_freqs[m] = std::cos(alpha);
+        _imp_fade_phases[m] = uniform(rng);
+    }
+}
+
+std::complex<float> SoapyLoopback::fadingAt(const double t) const
+{
+    if (fading == FADING_NONE) return 1.0f;
+
+    std::complex<double> h;
+    for (size_t m = 0; m < _imp_fade_freqs.size(); m++)
+    {
+        h += std::polar(1.0, 2*M_PI*doppler*_imp_fade_freqs[m]*t + _imp_fade_phases[m]);
+    }
+    h /= std::sqrt(double(_imp_fade_freqs.size()));
+
+    //rician adds a fixed line of sight path to the scattered ones
+    if (fading == FADING_RICIAN)
+    {
+        const double k = std::pow(10.0, ricianK/10);
+        h = std::sqrt(k/(k + 1)) + h*std::sqrt(1/(k + 1));
+    }
+    return std::complex<float>(h);
+}
+
+float SoapyLoopback::gaussian(void)
+{
+    if (_imp_noise.empty()) this->initImpairments();
+
+    //a table entry has half the variance of a unit normal
+    _imp_rng ^= _imp_rng << 13;
+    _imp_rng ^= _imp_rng >> 17;
+    _imp_rng ^= _imp_rng << 5;
+    return _imp_noise[_imp_rng % _imp_noise.size()]*float(M_SQRT2);
+}
+
+double SoapyLoopback::driftStep(const size_t numElems, const double rate)
+{
+    //the receiver clock is off by the frequency correction plus a slow
+    //random walk; the step is transmitter samples per receiver sample
+    const double step = 1.0/(1.0 + (ppm + _drift_walk)*1e-6);
+    if (ppmWalk != 0.0)
+    {
+        _drift_walk += ppmWalk*std::sqrt(numElems/rate)*this->gaussian();
+    }
+    else _drift_walk = 0.0;
+    return step;
+}
+
+void SoapyLoopback::impairSamples(std::complex<float> *buff, const size_t numElems, const double rate)
+{
+    if (_imp_noise.empty()) this->initImpairments();
+
+    //total gain of the receive chain
+    double gainDb = tunerGain;
+    for (int i = 0; i < 6; i++) gainDb += IFGain[i];
+    const float gain = std::pow(10.0, gainDb/20);
+
+    //offset between the transmit frequency and the receiver LO,
+    //which is off by the frequency correction in ppm
+    const double rxFreq = centerFrequency[SOAPY_SDR_RX]*(1.0 + ppm*1e-6);
+    const double dphi = 2*M_PI*(centerFrequency[SOAPY_SDR_TX] - rxFreq)/rate;
+
+    const float sigma = std::isinf(snr) ? 0.0f : std::pow(10.0, -snr/20);
+    const double dt = 1.0/rate;
+
+    //the Q branch has a gain error and is off quadrature by the phase error
+    const double qGain = std::pow(10.0, iqGain/20);
+    const float qa = qGain*std::cos(iqPhase*M_PI/180);
+    const float qb = qGain*std::sin(iqPhase*M_PI/180);
+
+    //rotation table for one block, rebuilt when the offset changes
+    if (_imp_rot_re.empty() or _imp_rot_dphi != dphi)
+    {
+        _imp_rot_dphi = dphi;
+        _imp_rot_re.resize(IMPAIR_BLOCK);
+        _imp_rot_im.resize(IMPAIR_BLOCK);
+        for (size_t k = 0; k < IMPAIR_BLOCK; k++)
+        {
+            _imp_rot_re[k] = std::cos(k*dphi);
+            _imp_rot_im[k] = std::sin(k*dphi);
+        }
+    }
+
+    float *x = reinterpret_cast<float *>(buff);
+    for (size_t i = 0; i < numElems; i += IMPAIR_BLOCK)
+    {
+        const size_t n = std::min<size_t>(IMPAIR_BLOCK, numElems - i);
+        const auto h0 = this->fadingAt(_imp_time);
+        const auto h1 = this->fadingAt(_imp_time + n*dt);
+
+        //xorshift picks where this block reads the noise table and a
+        //phase to turn it by, circular noise keeps its statistics turned
+        //and the table spans no longer repeat as the same samples
+        _imp_rng ^= _imp_rng << 13;
+        _imp_rng ^= _imp_rng >> 17;
+        _imp_rng ^= _imp_rng << 5;
+        const float *noise = _imp_noise.data() + 2*(_imp_rng % NOISE_TABLE_LENGTH);
+        _imp_rng ^= _imp_rng << 13;
+        _imp_rng ^= _imp_rng >> 17;
+        _imp_rng ^= _imp_rng << 5;
+        const auto noiseRot = std::polar(sigma, float(2*M_PI*(_imp_rng/4294967296.0)));
+
+        fusedImpairment(x + 2*i, int(n), gain*h0, gain*(h1 - h0)/float(n), std::polar(1.0f, float(_imp_phase)),
+            _imp_rot_re.data(), _imp_rot_im.data(), noise, noiseRot, qa, qb);
+        _imp_phase = std::fmod(_imp_phase + n*dphi, 2*M_PI);
+        _imp_time += n*dt;
+    }
+}
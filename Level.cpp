@@ -0,0 +1,108 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Level.hpp"
+#include <algorithm>
+#include <cmath>
+
+//samples in a window of the published levels
+#define LEVEL_WINDOW 65536
+
+LevelSums::LevelSums(void):
+    rawI(0),
+    rawQ(0),
+    sumI(0),
+    sumQ(0),
+    power(0),
+    peak(0),
+    clips(0)
+{
+    return;
+}
+
+LevelSums &LevelSums::operator+=(const LevelSums &other)
+{
+    rawI += other.rawI;
+    rawQ += other.rawQ;
+    sumI += other.sumI;
+    sumQ += other.sumQ;
+    power += other.power;
+    peak = std::max(peak, other.peak);
+    clips += other.clips;
+    return *this;
+}
+
+LevelMeter::LevelMeter(void):
+    _count(0),
+    _rmsDb(-INFINITY),
+    _peakDb(-INFINITY),
+    _dcDb(-INFINITY),
+    _clips(0),
+    _samples(0)
+{
+    return;
+}
+
+void LevelMeter::add(const LevelSums &sums, const size_t numElems)
+{
+    _window += sums;
+    _count += numElems;
+    _clips.fetch_add(sums.clips, std::memory_order_relaxed);
+    _samples.fetch_add(numElems, std::memory_order_relaxed);
+    if (_count < LEVEL_WINDOW) return;
+
+    //the sums are relative to full scale already
+    const double meanI = _window.sumI/_count;
+    const double meanQ = _window.sumQ/_count;
+    _rmsDb.store(float(10*std::log10(_window.power/_count)), std::memory_order_relaxed);
+    _peakDb.store(float(10*std::log10(_window.peak)), std::memory_order_relaxed);
+    _dcDb.store(float(10*std::log10(meanI*meanI + meanQ*meanQ)), std::memory_order_relaxed);
+    _window = LevelSums();
+    _count = 0;
+}
+
+float LevelMeter::rmsDb(void) const
+{
+    return _rmsDb.load(std::memory_order_relaxed);
+}
+
+float LevelMeter::peakDb(void) const
+{
+    return _peakDb.load(std::memory_order_relaxed);
+}
+
+float LevelMeter::dcDb(void) const
+{
+    return _dcDb.load(std::memory_order_relaxed);
+}
+
+unsigned long long LevelMeter::clips(void) const
+{
+    return _clips.load(std::memory_order_relaxed);
+}
+
+unsigned long long LevelMeter::samples(void) const
+{
+    return _samples.load(std::memory_order_relaxed);
+}
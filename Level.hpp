@@ -0,0 +1,191 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+//! Sums over a span of samples as read, made in the pass that converts them
+struct LevelSums
+{
+    LevelSums(void);
+
+    //! Add the sums of another span
+    LevelSums &operator+=(const LevelSums &other);
+
+    long long rawI, rawQ; //of the raw ring samples, for DC offset tracking
+    double sumI, sumQ; //for the DC level
+    double power; //I*I + Q*Q
+    double peak; //largest I*I + Q*Q
+    unsigned long long clips; //samples with I or Q at full scale
+};
+
+//samples in a group, one to each lane of the partial sums
+#define LEVEL_LANES 16
+
+//samples between folds of the lanes into the totals,
+//few enough that the integer lanes cannot overflow
+#define LEVEL_BLOCK 4096
+
+//! Words of the partial sums: integers for the integer formats, where
+//! I*I + Q*Q of 16 bit samples needs 64 bits once summed, and floats
+template <typename T> struct LevelLane {typedef int Sum; typedef int Power;};
+template <> struct LevelLane<int16_t> {typedef int Sum; typedef long long Power;};
+template <> struct LevelLane<float> {typedef float Sum; typedef float Power;};
+
+/*!
+ * Makes the level sums inside a conversion loop. The loop goes over the
+ * samples in groups of LEVEL_LANES and adds sample l of a group to lane l,
+ * so no lane depends on another and the loop vectorizes. The output
+ * samples are summed in their own word, and every LEVEL_BLOCK samples the
+ * lanes fold into totals relative to the full scale of the word.
+ */
+template <typename T>
+class LevelAccumulator
+{
+public:
+    LevelAccumulator(const double fullScale):
+        _fullScale(fullScale),
+        _clip(Sum(fullScale)*Sum(fullScale)),
+        _groups(0),
+        _rawI(0), _rawQ(0),
+        _sumI(0), _sumQ(0), _power(0), _peak(0),
+        _clips(0)
+    {
+        this->clear();
+    }
+
+    //! Sample l of a group: a raw ring sample and the sample it was converted to
+    void add(const size_t l, const int xi, const int xq, const T yi, const T yq)
+    {
+        const Sum i = yi, q = yq;
+        const Sum ii = i*i, qq = q*q;
+        const Sum p = ii + qq;
+        _laneRawI[l] += xi;
+        _laneRawQ[l] += xq;
+        _laneSumI[l] += i;
+        _laneSumQ[l] += q;
+        _lanePower[l] += p;
+        _lanePeak[l] = p > _lanePeak[l] ? p : _lanePeak[l];
+        _laneClips[l] += int(ii >= _clip) | int(qq >= _clip);
+    }
+
+    //! After each group
+    void next(void)
+    {
+        if (++_groups == LEVEL_BLOCK/LEVEL_LANES) this->fold();
+    }
+
+    void store(LevelSums &sums)
+    {
+        this->fold();
+        const double power = _fullScale*_fullScale;
+        sums.rawI = _rawI;
+        sums.rawQ = _rawQ;
+        sums.sumI = _sumI/_fullScale;
+        sums.sumQ = _sumQ/_fullScale;
+        sums.power = _power/power;
+        sums.peak = _peak/power;
+        sums.clips = _clips;
+    }
+
+private:
+    typedef typename LevelLane<T>::Sum Sum;
+    typedef typename LevelLane<T>::Power Power;
+    typedef typename std::conditional<std::is_integral<T>::value, long long, double>::type Total;
+
+    void clear(void)
+    {
+        for (size_t l = 0; l < LEVEL_LANES; l++)
+        {
+            _laneRawI[l] = _laneRawQ[l] = 0;
+            _laneSumI[l] = _laneSumQ[l] = _lanePeak[l] = 0;
+            _lanePower[l] = 0;
+            _laneClips[l] = 0;
+        }
+        _groups = 0;
+    }
+
+    void fold(void)
+    {
+        for (size_t l = 0; l < LEVEL_LANES; l++)
+        {
+            _rawI += _laneRawI[l];
+            _rawQ += _laneRawQ[l];
+            _sumI += _laneSumI[l];
+            _sumQ += _laneSumQ[l];
+            _power += _lanePower[l];
+            _peak = std::max<Total>(_peak, _lanePeak[l]);
+            _clips += _laneClips[l];
+        }
+        this->clear();
+    }
+
+    const double _fullScale;
+    const Sum _clip;
+    size_t _groups;
+    int _laneRawI[LEVEL_LANES], _laneRawQ[LEVEL_LANES];
+    Sum _laneSumI[LEVEL_LANES], _laneSumQ[LEVEL_LANES], _lanePeak[LEVEL_LANES];
+    Power _lanePower[LEVEL_LANES];
+    int _laneClips[LEVEL_LANES];
+    long long _rawI, _rawQ;
+    Total _sumI, _sumQ, _power, _peak;
+    unsigned long long _clips;
+};
+
+/*!
+ * Signal level of one stream channel, measured on the samples as read.
+ * The sums of every converted span are added up, and each full window
+ * publishes its RMS power, peak magnitude and DC level in dBFS, where
+ * a full scale complex tone is 0 dBFS. Clipped samples are counted from
+ * the start. The published values can be read from any thread.
+ */
+class LevelMeter
+{
+public:
+    LevelMeter(void);
+
+    //! Add the sums of a span of numElems samples
+    void add(const LevelSums &sums, const size_t numElems);
+
+    //! Levels of the last full window in dBFS
+    float rmsDb(void) const;
+    float peakDb(void) const;
+    float dcDb(void) const;
+
+    //! Clipped samples and all samples measured
+    unsigned long long clips(void) const;
+    unsigned long long samples(void) const;
+
+private:
+    LevelSums _window;
+    size_t _count;
+
+    std::atomic<float> _rmsDb, _peakDb, _dcDb;
+    std::atomic<unsigned long long> _clips, _samples;
+};
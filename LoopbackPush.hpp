@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <SoapySDR/Device.hpp>
+#include <cstddef>
+
+/*!
+ * Push mode streaming, a native extension of the loopback device.
+ *
+ * Set up the RX stream with the stream arg push=true and register a
+ * callback before activating it. The producer thread then calls the
+ * callback with every buffer it renders, in place in the CS8 ring
+ * format as with direct buffer access, and reuses the buffer as soon
+ * as the callback returns. There is no ring handoff and no reader to
+ * wake, so readStream and acquireReadBuffer are not supported on a
+ * push stream. A callback that takes longer than a buffer delays the
+ * producer, which catches up afterwards without dropping samples.
+ *
+ * The extension is reached from the device with a cross cast:
+ *
+ *     auto *push = dynamic_cast<SoapyLoopbackPush *>(device);
+ *     push->setRxCallback(stream, callback, user);
+ */
+class SoapyLoopbackPush
+{
+public:
+    /*!
+     * Called on the producer thread with one buffer per stream channel.
+     * \param user the pointer given to setRxCallback
+     * \param buffs the CS8 samples of each channel
+     * \param numElems the number of samples per channel
+     * \param timeNs the time of the first sample
+     * \param flags SOAPY_SDR_HAS_TIME
+     */
+    typedef void (*RxCallback)(void *user, const void * const *buffs, const size_t numElems, const long long timeNs, const int flags);
+
+    virtual ~SoapyLoopbackPush(void)
+    {
+        return;
+    }
+
+    /*!
+     * Register the callback of an inactive push stream.
+     * \return 0, SOAPY_SDR_NOT_SUPPORTED if this is not a push stream,
+     * or SOAPY_SDR_STREAM_ERROR if the stream is active
+     */
+    virtual int setRxCallback(SoapySDR::Stream *stream, RxCallback callback, void *user) = 0;
+
+    /*!
+     * The readiness descriptor of any RX stream, attached readers included.
+     * It polls readable while the stream has buffers; read with a zero
+     * timeout until SOAPY_SDR_TIMEOUT before polling again.
+     * The RX channel setting event_fd gives the same for the stream
+     * that carries a channel.
+     * \return the descriptor, or -1 for a TX stream or without one
+     */
+    virtual int getRxEventFd(SoapySDR::Stream *stream) const = 0;
+};
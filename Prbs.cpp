@@ -0,0 +1,259 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Prbs.hpp"
+#include <chrono>
+
+//bits in the window that decides a slip, and the errors
+//in it, an eighth, that a slip is taken for
+#define PRBS_WINDOW 1024
+#define PRBS_SLIP_ERRORS (PRBS_WINDOW/8)
+//bits that follow the recurrence before the checker locks, in orders
+#define PRBS_LOCK_ORDERS 2
+
+//second tap m of x^n + x^m + 1, 0 for an unknown order
+static int prbsTap(const int order)
+{
+    if (order == 15) return 14;
+    if (order == 23) return 18;
+    if (order == 31) return 28;
+    return 0;
+}
+
+static int popcount64(const uint64_t x)
+{
+    return __builtin_popcountll(x);
+}
+
+/*******************************************************************
+ * Generator
+ ******************************************************************/
+
+PrbsGenerator::PrbsGenerator(void):
+    _order(0),
+    _tap(0),
+    _mask(0),
+    _history(0)
+{
+    return;
+}
+
+void PrbsGenerator::configure(const int order)
+{
+    _tap = prbsTap(order);
+    _order = (_tap == 0) ? 0 : order;
+    _mask = (uint64_t(1) << _order) - 1;
+    _history = _mask;
+}
+
+int PrbsGenerator::order(void) const
+{
+    return _order;
+}
+
+void PrbsGenerator::seed(const uint64_t history)
+{
+    _history = history & _mask;
+}
+
+uint64_t PrbsGenerator::next(const size_t numBits)
+{
+    //bit k is bit k-n xor bit k-m, and the newest bit is the lowest
+    //of the history, so up to m new bits come from two shifts of it
+    uint64_t word = 0;
+    if (_order == 0) return word;
+    for (size_t done = 0; done < numBits;)
+    {
+        const int c = int(std::min<size_t>(numBits - done, _tap));
+        const uint64_t chunk = ((_history >> (_order - c)) ^ (_history >> (_tap - c))) & ((uint64_t(1) << c) - 1);
+        _history = ((_history << c) | chunk) & _mask;
+        word = (word << c) | chunk;
+        done += c;
+    }
+    return word;
+}
+
+void PrbsGenerator::generate(std::complex<float> *out, const size_t numElems)
+{
+    for (size_t k = 0; k < numElems; k += 32)
+    {
+        const size_t n = std::min<size_t>(32, numElems - k);
+        const uint64_t word = this->next(2*n);
+        for (size_t j = 0; j < n; j++)
+        {
+            const size_t bit = 2*(n - j) - 1;
+            out[k + j] = std::complex<float>(
+                ((word >> bit) & 1) ? -0.5f : 0.5f,
+                ((word >> (bit - 1)) & 1) ? -0.5f : 0.5f);
+        }
+    }
+}
+
+/*******************************************************************
+ * Checker
+ ******************************************************************/
+
+PrbsChecker::PrbsChecker(void):
+    _order(0),
+    _tap(0),
+    _mask(0),
+    _history(0),
+    _filled(0),
+    _run(0),
+    _windowBits(0),
+    _windowErrors(0),
+    _locked(false),
+    _bits(0),
+    _errors(0),
+    _slips(0),
+    _firstNs(0),
+    _lastNs(0)
+{
+    return;
+}
+
+void PrbsChecker::configure(const int order)
+{
+    _tap = prbsTap(order);
+    _order = (_tap == 0) ? 0 : order;
+    _mask = (uint64_t(1) << _order) - 1;
+    _ref.configure(_order);
+    _bits = 0;
+    _errors = 0;
+    _slips = 0;
+    _firstNs = 0;
+    _lastNs = 0;
+    this->resync();
+}
+
+int PrbsChecker::order(void) const
+{
+    return _order;
+}
+
+void PrbsChecker::resync(void)
+{
+    _locked = false;
+    _history = 0;
+    _filled = 0;
+    _run = 0;
+    _windowBits = 0;
+    _windowErrors = 0;
+}
+
+void PrbsChecker::check12(const uint8_t *in, const size_t numElems)
+{
+    //the sign of I is bit 3 of the middle byte, the sign of Q bit 7 of the last
+    for (size_t k = 0; k < numElems; k += 32)
+    {
+        const size_t n = std::min<size_t>(32, numElems - k);
+        uint64_t word = 0;
+        for (size_t j = 0; j < n; j++)
+        {
+            const uint8_t *x = in + 3*(k + j);
+            word = (word << 2) | ((x[1] >> 2) & 2) | (x[2] >> 7);
+        }
+        this->checkWord(word, 2*n);
+    }
+    this->stamp();
+}
+
+void PrbsChecker::checkWord(const uint64_t word, const size_t numBits)
+{
+    if (_order == 0) return;
+
+    //a whole word against the copy of the sequence, one xor and a count
+    if (_locked)
+    {
+        const unsigned long long errors = popcount64(word ^ _ref.next(numBits));
+        _bits.fetch_add(numBits, std::memory_order_relaxed);
+        _errors.fetch_add(errors, std::memory_order_relaxed);
+        _windowBits += numBits;
+        _windowErrors += errors;
+        if (_windowBits < PRBS_WINDOW) return;
+        const bool slip = _windowErrors > PRBS_SLIP_ERRORS*_windowBits/PRBS_WINDOW;
+        _windowBits = 0;
+        _windowErrors = 0;
+        if (not slip) return;
+        _slips.fetch_add(1, std::memory_order_relaxed);
+        return this->resync();
+    }
+
+    //bit by bit until a run follows the recurrence, the all zero
+    //history follows it as well and is what silence looks like
+    for (size_t j = 0; j < numBits; j++)
+    {
+        const uint64_t bit = (word >> (numBits - 1 - j)) & 1;
+        if (_filled >= size_t(_order))
+        {
+            const uint64_t expected = ((_history >> (_order - 1)) ^ (_history >> (_tap - 1))) & 1;
+            _run = (expected == bit) ? _run + 1 : 0;
+        }
+        else _filled++;
+        _history = ((_history << 1) | bit) & _mask;
+        if (_run >= size_t(PRBS_LOCK_ORDERS*_order) and _history != 0)
+        {
+            _ref.seed(_history);
+            _locked = true;
+            const size_t rest = numBits - 1 - j;
+            if (rest != 0) this->checkWord(word & ((uint64_t(1) << rest) - 1), rest);
+            return;
+        }
+    }
+}
+
+void PrbsChecker::stamp(void)
+{
+    const long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (_firstNs == 0) _firstNs = now;
+    _lastNs = now;
+}
+
+unsigned long long PrbsChecker::bits(void) const
+{
+    return _bits.load(std::memory_order_relaxed);
+}
+
+unsigned long long PrbsChecker::errors(void) const
+{
+    return _errors.load(std::memory_order_relaxed);
+}
+
+unsigned long long PrbsChecker::slips(void) const
+{
+    return _slips.load(std::memory_order_relaxed);
+}
+
+bool PrbsChecker::locked(void) const
+{
+    return _locked;
+}
+
+double PrbsChecker::rate(void) const
+{
+    const long long elapsed = _lastNs - _firstNs;
+    if (elapsed <= 0) return 0.0;
+    return _bits*1e9/elapsed;
+}
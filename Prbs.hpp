@@ -0,0 +1,126 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+/*!
+ * Pseudo random bit sequence of order 15, 23 or 31, the ITU-T O.150
+ * polynomials x^n + x^m + 1. The bits are made a chunk of up to m at
+ * a time, since none of them depends on another bit of the same chunk.
+ * A word of bits holds the first of them in its highest bit.
+ */
+class PrbsGenerator
+{
+public:
+    PrbsGenerator(void);
+
+    //! Restart the sequence of an order, 0 stops it
+    void configure(const int order);
+
+    //! The order of the sequence, 0 when stopped
+    int order(void) const;
+
+    //! Continue the sequence from the last order bits of it
+    void seed(const uint64_t history);
+
+    //! The next numBits bits of the sequence, at most 64
+    uint64_t next(const size_t numBits);
+
+    //! The next bits as QPSK samples of amplitude 0.5, the first bit of
+    //! each pair on I and the second on Q, and a one bit is negative
+    void generate(std::complex<float> *out, const size_t numElems);
+
+private:
+    int _order, _tap;
+    uint64_t _mask, _history;
+};
+
+/*!
+ * Bit error checker for the sequence in the signs of received samples.
+ * Unlocked, it waits for a run of bits that follow the recurrence of the
+ * sequence, then it locks and compares every bit with its own copy.
+ * A window with more errors than a bad channel can make is a slip,
+ * and the checker unlocks to find the sequence again.
+ * The counters can be read from any thread.
+ */
+class PrbsChecker
+{
+public:
+    PrbsChecker(void);
+
+    //! Look for the sequence of an order and clear the counters
+    void configure(const int order);
+
+    //! The order it looks for, 0 when off
+    int order(void) const;
+
+    //! Find the sequence again after a gap, this is not a slip
+    void resync(void);
+
+    //! Check the signs of numElems interleaved I/Q samples
+    template <typename T>
+    void check(const T *iq, const size_t numElems)
+    {
+        for (size_t k = 0; k < numElems; k += 32)
+        {
+            const size_t n = std::min<size_t>(32, numElems - k);
+            uint64_t word = 0;
+            for (size_t j = 0; j < 2*n; j++) word = (word << 1) | uint64_t(iq[2*k + j] < 0);
+            this->checkWord(word, 2*n);
+        }
+        this->stamp();
+    }
+
+    //! Check the signs of CS12 samples, packed in three bytes each
+    void check12(const uint8_t *in, const size_t numElems);
+
+    //! Bits compared while locked, the errors among them and the slips
+    unsigned long long bits(void) const;
+    unsigned long long errors(void) const;
+    unsigned long long slips(void) const;
+    bool locked(void) const;
+
+    //! Bits compared per second since the first check
+    double rate(void) const;
+
+private:
+    void checkWord(const uint64_t word, const size_t numBits);
+    void stamp(void);
+
+    int _order, _tap;
+    uint64_t _mask, _history;
+    size_t _filled, _run;
+    size_t _windowBits, _windowErrors;
+    PrbsGenerator _ref;
+
+    std::atomic<bool> _locked;
+    std::atomic<unsigned long long> _bits, _errors, _slips;
+    std::atomic<long long> _firstNs, _lastNs;
+};
@@ -0,0 +1,72 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ReadyEvent.hpp"
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cstdint>
+#endif
+
+ReadyEvent::ReadyEvent(void):
+    _fd(-1)
+{
+#ifdef __linux__
+    _fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+ReadyEvent::~ReadyEvent(void)
+{
+#ifdef __linux__
+    if (_fd >= 0) close(_fd);
+#endif
+}
+
+int ReadyEvent::fd(void) const
+{
+    return _fd;
+}
+
+void ReadyEvent::signal(void)
+{
+#ifdef __linux__
+    //a write only fails when the counter is full, which is readable anyway
+    const uint64_t one = 1;
+    if (_fd < 0) return;
+    const ssize_t ret = write(_fd, &one, sizeof(one));
+    (void)ret;
+#endif
+}
+
+void ReadyEvent::clear(void)
+{
+#ifdef __linux__
+    //the counter is reset by one read, which fails when it was zero
+    uint64_t count = 0;
+    if (_fd < 0) return;
+    const ssize_t ret = read(_fd, &count, sizeof(count));
+    (void)ret;
+#endif
+}
@@ -0,0 +1,54 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+/*!
+ * A descriptor that polls readable while a stream has data.
+ * It is signalled when the stream goes from empty to not empty and
+ * cleared by the reader once it finds the stream empty, so an event
+ * loop can wait on many streams at once with poll or epoll.
+ * Backed by an eventfd on Linux, elsewhere there is no descriptor.
+ */
+class ReadyEvent
+{
+public:
+    ReadyEvent(void);
+    ~ReadyEvent(void);
+
+    //! The descriptor to poll for reading, -1 when unsupported
+    int fd(void) const;
+
+    //! Make the descriptor readable
+    void signal(void);
+
+    //! Drain the descriptor so that it no longer polls readable
+    void clear(void);
+
+private:
+    ReadyEvent(const ReadyEvent &);
+    ReadyEvent &operator=(const ReadyEvent &);
+
+    int _fd;
+};
@@ -0,0 +1,231 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "Replay.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+static size_t bytesPerSample(const int format)
+{
+    switch (format)
+    {
+    case REPLAY_CS8: return 2;
+    case REPLAY_CS16: return 4;
+    default: return 8;
+    }
+}
+
+//read exactly size bytes at offset, pread may return less
+static bool readAt(const int fd, void *buff, const size_t size, const uint64_t offset)
+{
+    size_t done = 0;
+    while (done < size)
+    {
+        const ssize_t ret = pread(fd, (char *)buff + done, size - done, off_t(offset + done));
+        if (ret < 0 and errno == EINTR) continue;
+        if (ret <= 0) return false;
+        done += size_t(ret);
+    }
+    return true;
+}
+
+CaptureReplay::CaptureReplay(const std::string &path, const size_t threads, const size_t ahead, const size_t maxElems):
+    _fd(-1),
+    _next(0),
+    _head(0),
+    _running(true),
+    _errors(0)
+{
+    _fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (_fd < 0) throw std::runtime_error("CaptureReplay: open(" + path + ") " + std::string(std::strerror(errno)));
+
+    auto fail = [this, &path](const std::string &what)
+    {
+        close(_fd);
+        throw std::runtime_error("CaptureReplay: " + path + " " + what);
+    };
+
+    if (not readAt(_fd, &_header, sizeof(_header), 0) or std::memcmp(_header.magic, "LBCAPTR1", 8) != 0)
+    {
+        fail("is not a capture container");
+    }
+    if (_header.format > REPLAY_CF32 or _header.codec > REPLAY_ZSTD) fail("has an unknown format or codec");
+#ifndef HAVE_ZSTD
+    if (_header.codec == REPLAY_ZSTD) fail("is zstd compressed, which this build does not support");
+#endif
+
+    const off_t fileSize = lseek(_fd, 0, SEEK_END);
+    if (_header.indexOffset > uint64_t(fileSize) or
+        _header.numChunks > (uint64_t(fileSize) - _header.indexOffset)/sizeof(ReplayIndexEntry))
+    {
+        fail("has an index past the end of the file");
+    }
+    _index.resize(_header.numChunks);
+    if (not readAt(_fd, _index.data(), _index.size()*sizeof(ReplayIndexEntry), _header.indexOffset))
+    {
+        fail("has an unreadable index");
+    }
+
+    //chunks follow each other on the capture timeline and fit a slot
+    for (size_t i = 0; i < _index.size(); i++)
+    {
+        const auto &entry = _index[i];
+        if (entry.numElems > maxElems) fail("has a chunk over " + std::to_string(maxElems) + " samples");
+        if (i != 0 and entry.tick < _index[i-1].tick + int64_t(_index[i-1].numElems)) fail("has overlapping chunks");
+        if (_header.codec == REPLAY_STORED and entry.bytes != entry.numElems*bytesPerSample(_header.format))
+        {
+            fail("has a stored chunk of the wrong size");
+        }
+    }
+
+    _slots.resize(std::max<size_t>(ahead, 1));
+    _states.resize(_slots.size(), SLOT_EMPTY);
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); i++)
+    {
+        _threads.push_back(std::thread(&CaptureReplay::worker, this));
+    }
+}
+
+CaptureReplay::~CaptureReplay(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+    _workCond.notify_all();
+    for (auto &thread : _threads) thread.join();
+    close(_fd);
+}
+
+int CaptureReplay::format(void) const
+{
+    return int(_header.format);
+}
+
+long long CaptureReplay::firstTick(void) const
+{
+    return _index.empty() ? 0 : _index.front().tick;
+}
+
+bool CaptureReplay::decode(const ReplayIndexEntry &entry, std::vector<char> &packed, ReplayChunk &chunk, void *context)
+{
+    chunk.tick = entry.tick;
+    chunk.numElems = entry.numElems;
+    chunk.data.resize(entry.numElems*bytesPerSample(_header.format));
+
+    //stored chunks are read straight into the slot
+    if (_header.codec == REPLAY_STORED) return readAt(_fd, chunk.data.data(), chunk.data.size(), entry.offset);
+
+    packed.resize(entry.bytes);
+    if (not readAt(_fd, packed.data(), packed.size(), entry.offset)) return false;
+#ifdef HAVE_ZSTD
+    const size_t ret = ZSTD_decompressDCtx((ZSTD_DCtx *)context, chunk.data.data(), chunk.data.size(), packed.data(), packed.size());
+    return not ZSTD_isError(ret) and ret == chunk.data.size();
+#else
+    return false;
+#endif
+}
+
+void CaptureReplay::worker(void)
+{
+    std::vector<char> packed;
+#ifdef HAVE_ZSTD
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+#else
+    void *context = nullptr;
+#endif
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        //claim the next chunk once its slot is free
+        _workCond.wait(lock, [this]
+        {
+            return not _running or (_next < _index.size() and _next < _head + _slots.size());
+        });
+        if (not _running) break;
+        const size_t i = _next++;
+        const size_t slot = i % _slots.size();
+        _states[slot] = SLOT_BUSY;
+
+        lock.unlock();
+        const bool ok = this->decode(_index[i], packed, _slots[slot], context);
+        lock.lock();
+
+        //a bad chunk plays as a gap
+        if (not ok)
+        {
+            _errors++;
+            _slots[slot].numElems = 0;
+        }
+        _states[slot] = SLOT_READY;
+        _readyCond.notify_all();
+    }
+
+#ifdef HAVE_ZSTD
+    ZSTD_freeDCtx(context);
+#endif
+}
+
+const ReplayChunk *CaptureReplay::front(const long timeoutUs)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto ready = [this]
+    {
+        return _head == _index.size() or _states[_head % _slots.size()] == SLOT_READY;
+    };
+    if (not _readyCond.wait_for(lock, std::chrono::microseconds(timeoutUs), ready)) return nullptr;
+    if (_head == _index.size()) return nullptr;
+    return &_slots[_head % _slots.size()];
+}
+
+void CaptureReplay::pop(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _states[_head % _slots.size()] = SLOT_EMPTY;
+        _head++;
+    }
+    _workCond.notify_all();
+}
+
+bool CaptureReplay::finished(void) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _head == _index.size();
+}
+
+unsigned long long CaptureReplay::errors(void) const
+{
+    return _errors;
+}
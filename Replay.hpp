@@ -0,0 +1,123 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//sample formats and codecs of a capture container
+enum ReplayFormat {REPLAY_CS8, REPLAY_CS16, REPLAY_CF32};
+enum ReplayCodec {REPLAY_STORED, REPLAY_ZSTD};
+
+//! Container header at the start of the file, little endian
+struct ReplayHeader
+{
+    char magic[8]; //"LBCAPTR1"
+    uint32_t format; //ReplayFormat
+    uint32_t codec; //ReplayCodec
+    uint64_t indexOffset; //file offset of the index
+    uint64_t numChunks; //entries in the index
+};
+
+//! Index entry of one chunk, the index is sorted by tick
+struct ReplayIndexEntry
+{
+    int64_t tick; //capture tick of the first sample
+    uint64_t offset; //file offset of the chunk
+    uint32_t bytes; //size of the chunk in the file
+    uint32_t numElems; //samples in the chunk
+};
+
+//! One chunk of samples in the stored format
+struct ReplayChunk
+{
+    long long tick;
+    size_t numElems;
+    std::vector<char> data;
+};
+
+/*!
+ * Reads a capture container: the header, chunks of samples compressed
+ * one by one, and an index of where each chunk is and on which tick it
+ * starts. A pool of threads decompresses the chunks that come next into
+ * a ring of slots ahead of the reader, reading with pread so that they
+ * share the descriptor, and the reader takes the chunks in index order.
+ * The index keeps the capture timeline, gaps between chunks included.
+ * zstd chunks need a build with HAVE_ZSTD, stored chunks always work.
+ */
+class CaptureReplay
+{
+public:
+    CaptureReplay(const std::string &path, const size_t threads, const size_t ahead, const size_t maxElems);
+    ~CaptureReplay(void);
+
+    //! ReplayFormat of the samples in every chunk
+    int format(void) const;
+
+    //! Tick of the first chunk, or zero for an empty capture
+    long long firstTick(void) const;
+
+    //! Next chunk in order, null after timeoutUs or at the end
+    const ReplayChunk *front(const long timeoutUs);
+
+    //! Hand the front chunk back to the pool
+    void pop(void);
+
+    //! Every chunk was taken
+    bool finished(void) const;
+
+    //! Chunks that failed to read or decompress, they come out empty
+    unsigned long long errors(void) const;
+
+private:
+    CaptureReplay(const CaptureReplay &);
+    CaptureReplay &operator=(const CaptureReplay &);
+
+    void worker(void);
+    bool decode(const ReplayIndexEntry &entry, std::vector<char> &packed, ReplayChunk &chunk, void *context);
+
+    enum SlotState {SLOT_EMPTY, SLOT_BUSY, SLOT_READY};
+
+    int _fd;
+    ReplayHeader _header;
+    std::vector<ReplayIndexEntry> _index;
+
+    //chunk i decodes into slot i % ahead, once chunk i - ahead is popped
+    std::vector<ReplayChunk> _slots;
+    std::vector<SlotState> _states;
+    size_t _next, _head;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _workCond, _readyCond;
+    bool _running;
+    std::vector<std::thread> _threads;
+    std::atomic<unsigned long long> _errors;
+};
@@ -0,0 +1,110 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "Resampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//input samples kept between calls, the interpolator spans x[-1] to x[2]
+#define RESAMPLER_HISTORY 4
+
+//cubic lagrange interpolation between x0 and x1 at fraction mu
+static inline float farrowCubic(const float xm1, const float x0, const float x1, const float x2, const float mu)
+{
+    const float c1 = -xm1*(1.0f/3) - x0*0.5f + x1 - x2*(1.0f/6);
+    const float c2 = xm1*0.5f - x0 + x1*0.5f;
+    const float c3 = (x2 - xm1)*(1.0f/6) + (x0 - x1)*0.5f;
+    return ((c3*mu + c2)*mu + c1)*mu + x0;
+}
+
+FarrowResampler::FarrowResampler(void)
+{
+    this->reset();
+}
+
+void FarrowResampler::reset(void)
+{
+    _pos = RESAMPLER_HISTORY;
+    _work.assign(RESAMPLER_HISTORY, std::complex<float>(0.0f));
+}
+
+size_t FarrowResampler::inputsNeeded(const size_t numOut, const double step) const
+{
+    if (numOut == 0) return 0;
+    const size_t last = size_t(std::floor(_pos + (numOut - 1)*step)) + 3;
+    return last - RESAMPLER_HISTORY;
+}
+
+void FarrowResampler::process(const std::complex<float> *in, std::complex<float> *out, const size_t numOut, const double step)
+{
+    if (numOut == 0) return;
+    const size_t numIn = this->inputsNeeded(numOut, step);
+
+    //history followed by the new input
+    _work.resize(RESAMPLER_HISTORY + numIn);
+    std::memcpy(_work.data() + RESAMPLER_HISTORY, in, numIn*sizeof(std::complex<float>));
+
+    //integer and fractional position of every output, no carried state
+    _index.resize(numOut);
+    _mu.resize(numOut);
+    const double pos0 = _pos;
+    const int n = int(numOut);
+    for (int k = 0; k < n; k++)
+    {
+        const double pos = pos0 + k*step;
+        const int i = int(pos);
+        _index[k] = i;
+        _mu[k] = float(pos - i);
+    }
+
+    //evaluate the cubic in Horner form around x[0] = work[i];
+    //for a step close to one the input index only slips against the
+    //output index now and then, so work on runs where the offset is
+    //constant and the loads stay contiguous
+    const float *w = reinterpret_cast<const float *>(_work.data());
+    float *y = reinterpret_cast<float *>(out);
+    const int *index = _index.data();
+    const float *frac = _mu.data();
+    for (int k = 0; k < n;)
+    {
+        const int offset = index[k] - k;
+        int end = k + 1;
+        while (end < n and index[end] - end == offset) end++;
+        const float *x = w + 2*offset;
+        for (int j = k; j < end; j++)
+        {
+            y[2*j+0] = farrowCubic(x[2*j-2], x[2*j+0], x[2*j+2], x[2*j+4], frac[j]);
+            y[2*j+1] = farrowCubic(x[2*j-1], x[2*j+1], x[2*j+3], x[2*j+5], frac[j]);
+        }
+        k = end;
+    }
+
+    //keep the tail as history and rebase the position onto it
+    const size_t drop = _work.size() - RESAMPLER_HISTORY;
+    std::memmove(_work.data(), _work.data() + drop, RESAMPLER_HISTORY*sizeof(std::complex<float>));
+    _work.resize(RESAMPLER_HISTORY);
+    _pos = pos0 + numOut*step - drop;
+}
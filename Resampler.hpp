@@ -0,0 +1,56 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <complex>
+#include <vector>
+#include <cstddef>
+
+/*!
+ * Cubic Lagrange resampler in Farrow form.
+ * The step is the number of input samples per output sample and may
+ * change on every call, which is how sample clock drift is emulated.
+ * Input is consumed in whole samples; the fractional phase and the
+ * last few input samples are kept between calls.
+ */
+class FarrowResampler
+{
+public:
+    FarrowResampler(void);
+
+    void reset(void);
+
+    //! Number of input samples the next process() call consumes
+    size_t inputsNeeded(const size_t numOut, const double step) const;
+
+    //! Produce numOut samples from inputsNeeded(numOut, step) inputs
+    void process(const std::complex<float> *in, std::complex<float> *out, const size_t numOut, const double step);
+
+private:
+    double _pos;
+    std::vector<std::complex<float> > _work;
+    std::vector<int> _index;
+    std::vector<float> _mu;
+};
@@ -24,8 +24,13 @@
  */
 
 #include "SoapyLoopback.hpp"
+#include <SoapySDR/Formats.hpp>
 #include <SoapySDR/Time.hpp>
 #include <algorithm>
+#include <cmath> //INFINITY
+#include <sstream>
+#include <cstdio>
+#include <limits>
 
 SoapyLoopback::SoapyLoopback(const SoapySDR::Kwargs &args):
     deviceId(-1),
@@ -33,30 +38,205 @@ SoapyLoopback::SoapyLoopback(const SoapySDR::Kwargs &args):
     //tunerType(RTLSDR_TUNER_R820T),
     _ref_source("internal"),
     time_source("sw_ticks"),
+    _timebase_name("default"),
+    _timebase_offset(0),
+    _pps_pending(false),
+    _pps_edge(0),
+    _pps_time(0),
     sampleRate(2048000),
-    centerFrequency(100000000),
     bandwidth(0),
     ppm(0),
     directSamplingMode(0),
-    numBuffers(DEFAULT_NUM_BUFFERS),
-    bufferLength(DEFAULT_BUFFER_LENGTH),
     iqSwap(false),
     gainMode(false),
     offsetMode(false),
     digitalAGC(false),
     ticks(false),
-    bufferedElems(0),
-    resetBuffer(false),
+    _tx_engine(findEngine(SOAPY_SDR_CS8)),
+    dcOffsetMode(false),
+    iqBalance(1.0),
+    commandTime(0),
+    impairments(false),
+    snr(INFINITY),
+    ricianK(10.0),
+    doppler(10.0),
+    iqGain(0.0),
+    iqPhase(0.0),
+    fading(FADING_NONE),
+    _imp_phase(0.0),
+    _imp_time(0.0),
+    _imp_rot_dphi(0.0),
+    _imp_rng(1),
+    ppmWalk(0.0),
+    _drift_walk(0.0),
+    oversample(1),
+    _filter_decim(1),
+    _filter_changed(false),
+    _rate_changed(false),
+    _filter_active(false),
+    channelizer(0),
+    agcReference(-20.0),
+    agcAttack(0.001),
+    agcDecay(0.1),
+    loopbackDelay(0),
+    _tx_cursor(0),
+    _air_restart(false),
+    _tx_active(false),
+    _tx_start_tick(std::numeric_limits<long long>::min()),
+    _tx_status(STATUS_QUEUE_LENGTH),
+    _tx_burst_ends(BURST_QUEUE_LENGTH),
+    _tx_burst_next(0),
+    _tx_burst_pending(false),
+    _tx_in_burst(false),
+    _tx_late(false),
+    bridgeLatency(DEFAULT_BUFFER_LENGTH / BYTES_PER_SAMPLE),
+    _bridge_offset(0),
+    _bridge_anchored(false),
+    _bridge_running(false),
+    _replay_offset(0),
+    _replay_cursor(0),
+    _replay_done(false),
+    _replay_running(false),
+    _replay_chunks(0),
+    _replay_late(0),
+    prbsOrder(0),
+    _prbs_held(0),
+    _prbs_phase(0),
+    virtualTime(false),
+    _rx_async_running(false),
     gainMin(0.0),
     gainMax(0.0)
 {
+    centerFrequency[SOAPY_SDR_TX] = centerFrequency[SOAPY_SDR_RX] = 100000000;
+    for (int i = 0; i < 6; i++) IFGain[i] = 0.0;
+    tunerGain = 0.0;
+    biasTee = false;
 
+    //channelizer=N splits one wideband stream into N RX channels
+    if (args.count("channelizer") != 0)
+    {
+        try
+        {
+            int channelizer_in = std::stoi(args.at("channelizer"));
+            if (channelizer_in >= 2 and channelizer_in <= 1024 and (channelizer_in & (channelizer_in - 1)) == 0)
+            {
+                channelizer = channelizer_in;
+            }
+        }
+        catch (const std::invalid_argument &){}
+        if (channelizer == 0)
+        {
+            throw std::runtime_error("SoapyLoopback: channelizer must be a power of two from 2 to 1024");
+        }
+        _rx_channelizer.configure(channelizer);
+        SoapySDR_logf(SOAPY_SDR_INFO, "Loopback channelizer with %d channels", int(channelizer));
+    }
+
+    _rx_agc = std::vector<BlockAgc>(this->getNumChannels(SOAPY_SDR_RX));
+
+    //virtual_time=true runs the sample clock as fast as the streams go
+    if (args.count("virtual_time") != 0)
+    {
+        virtualTime = (args.at("virtual_time") == "true");
+        if (virtualTime) SoapySDR_log(SOAPY_SDR_INFO, "Loopback in virtual time");
+    }
+
+    //devices given the same timebase name share a reference
+    //once their clock source is set to external or ext+pps
+    if (args.count("timebase") != 0) _timebase_name = args.at("timebase");
+
+    //bridge_tx=path sends the transmitted samples to a device in another
+    //process that was made with bridge_rx=path, over a unix socket of
+    //bridge_type seqpacket or dgram, in frames of bridge_frame samples
+    //and sendmmsg batches of bridge_batch frames, queueing at most
+    //bridge_depth frames for a receiver that falls behind
+    if (args.count("bridge_tx") != 0 or args.count("bridge_rx") != 0)
+    {
+        size_t frame = 1024, batch = 16, depth = 0;
+        try
+        {
+            if (args.count("bridge_frame") != 0) frame = std::stoul(args.at("bridge_frame"));
+            if (args.count("bridge_batch") != 0) batch = std::stoul(args.at("bridge_batch"));
+            if (args.count("bridge_depth") != 0) depth = std::stoul(args.at("bridge_depth"));
+            if (args.count("bridge_latency") != 0) bridgeLatency = std::stoul(args.at("bridge_latency"));
+        }
+        catch (const std::exception &)
+        {
+            throw std::runtime_error("SoapyLoopback: bridge_frame, bridge_batch, bridge_depth and bridge_latency must be numbers");
+        }
+        if (depth == 0) depth = 4*batch;
+        if (frame == 0 or frame > 65536 or batch == 0 or batch > 1024 or depth < batch or depth > 4096 or bridgeLatency >= DEFAULT_AIR_LENGTH/4)
+        {
+            throw std::runtime_error("SoapyLoopback: bridge_frame 1 to 65536, bridge_batch 1 to 1024, bridge_depth bridge_batch to 4096, bridge_latency under a quarter of the air");
+        }
+        const bool datagram = args.count("bridge_type") != 0 and args.at("bridge_type") == "dgram";
+        if (args.count("bridge_type") != 0 and not datagram and args.at("bridge_type") != "seqpacket")
+        {
+            throw std::runtime_error("SoapyLoopback: bridge_type must be seqpacket or dgram");
+        }
+
+        if (args.count("bridge_tx") != 0)
+        {
+            const bool zeroCopy = args.count("bridge_zerocopy") != 0 and args.at("bridge_zerocopy") == "true";
+            _bridge_tx.reset(new SocketBridge(frame, batch, depth));
+            _bridge_tx->connect(args.at("bridge_tx"), datagram, zeroCopy);
+            SoapySDR_logf(SOAPY_SDR_INFO, "Loopback bridge sending to %s", args.at("bridge_tx").c_str());
+        }
+        if (args.count("bridge_rx") != 0)
+        {
+            //frames land on the wall clock of the receiver
+            if (virtualTime) throw std::runtime_error("SoapyLoopback: bridge_rx needs real time");
+            _bridge_rx.reset(new SocketBridge(frame, batch, depth));
+            _bridge_rx->bind(args.at("bridge_rx"), datagram, 100);
+            _air_restart = true;
+            _bridge_running = true;
+            _bridge_thread = std::thread(&SoapyLoopback::bridge_rx_operation, this);
+            SoapySDR_logf(SOAPY_SDR_INFO, "Loopback bridge receiving on %s", args.at("bridge_rx").c_str());
+        }
+    }
+
+    //replay=path plays a capture container into the air on the ticks of
+    //its index, replay_threads decompress up to replay_ahead chunks ahead
+    if (args.count("replay") != 0)
+    {
+        size_t threads = 2, ahead = 8;
+        try
+        {
+            if (args.count("replay_threads") != 0) threads = std::stoul(args.at("replay_threads"));
+            if (args.count("replay_ahead") != 0) ahead = std::stoul(args.at("replay_ahead"));
+        }
+        catch (const std::exception &)
+        {
+            throw std::runtime_error("SoapyLoopback: replay_threads and replay_ahead must be numbers");
+        }
+        if (threads == 0 or threads > 64 or ahead < threads or ahead > 1024)
+        {
+            throw std::runtime_error("SoapyLoopback: replay_threads 1 to 64, replay_ahead from replay_threads to 1024");
+        }
+        _replay.reset(new CaptureReplay(args.at("replay"), threads, ahead, DEFAULT_AIR_LENGTH/4));
+
+        //the air is placed when the producer first starts
+        _air_restart = true;
+        _replay_running = true;
+        _replay_thread = std::thread(&SoapyLoopback::replay_operation, this);
+        SoapySDR_logf(SOAPY_SDR_INFO, "Loopback replay of %s from tick %lld", args.at("replay").c_str(), _replay->firstTick());
+    }
 }
 
 SoapyLoopback::~SoapyLoopback(void)
 {
     //cleanup device handles
     //rtlsdr_close(dev);
+
+    //stop the producer if the stream was left active
+    this->stopProducer();
+
+    _bridge_running = false;
+    if (_bridge_thread.joinable()) _bridge_thread.join();
+
+    _replay_running = false;
+    _air_cond.notify_all();
+    if (_replay_thread.joinable()) _replay_thread.join();
 }
 
 /*******************************************************************
@@ -91,12 +271,13 @@ SoapySDR::Kwargs SoapyLoopback::getHardwareInfo(void) const
 
 size_t SoapyLoopback::getNumChannels(const int dir) const
 {
+    if (dir == SOAPY_SDR_RX and channelizer != 0) return channelizer;
     return 2;
 }
 
 bool SoapyLoopback::getFullDuplex(const int direction, const size_t channel) const
 {
-    return false;
+    return true;
 }
 
 /*******************************************************************
@@ -130,7 +311,55 @@ std::string SoapyLoopback::getAntenna(const int direction, const size_t channel)
 
 bool SoapyLoopback::hasDCOffsetMode(const int direction, const size_t channel) const
 {
-    return false;
+    return direction == SOAPY_SDR_RX;
+}
+
+void SoapyLoopback::setDCOffsetMode(const int direction, const size_t channel, const bool automatic)
+{
+    dcOffsetMode = automatic;
+}
+
+bool SoapyLoopback::getDCOffsetMode(const int direction, const size_t channel) const
+{
+    return dcOffsetMode;
+}
+
+bool SoapyLoopback::hasDCOffset(const int direction, const size_t channel) const
+{
+    return direction == SOAPY_SDR_RX;
+}
+
+void SoapyLoopback::setDCOffset(const int direction, const size_t channel, const std::complex<double> &offset)
+{
+    std::lock_guard<std::mutex> lock(_correction_mutex);
+    dcOffset = offset;
+}
+
+std::complex<double> SoapyLoopback::getDCOffset(const int direction, const size_t channel) const
+{
+    std::lock_guard<std::mutex> lock(_correction_mutex);
+    return dcOffset;
+}
+
+bool SoapyLoopback::hasIQBalance(const int direction, const size_t channel) const
+{
+    return direction == SOAPY_SDR_RX;
+}
+
+void SoapyLoopback::setIQBalance(const int direction, const size_t channel, const std::complex<double> &balance)
+{
+    if (std::abs(balance) == 0.0 or std::abs(std::arg(balance)) >= M_PI/2)
+    {
+        throw std::runtime_error("setIQBalance: gain must be nonzero and phase within +/-90 degrees");
+    }
+    std::lock_guard<std::mutex> lock(_correction_mutex);
+    iqBalance = balance;
+}
+
+std::complex<double> SoapyLoopback::getIQBalance(const int direction, const size_t channel) const
+{
+    std::lock_guard<std::mutex> lock(_correction_mutex);
+    return iqBalance;
 }
 
 bool SoapyLoopback::hasFrequencyCorrection(const int direction, const size_t channel) const
@@ -140,12 +369,12 @@ bool SoapyLoopback::hasFrequencyCorrection(const int direction, const size_t cha
 
 void SoapyLoopback::setFrequencyCorrection(const int direction, const size_t channel, const double value)
 {
-    ppm = int(value);
+    ppm = value;
 }
 
 double SoapyLoopback::getFrequencyCorrection(const int direction, const size_t channel) const
 {
-    return double(ppm);
+    return ppm;
 }
 
 /*******************************************************************
@@ -192,6 +421,12 @@ void SoapyLoopback::setGain(const int direction, const size_t channel, const dou
 }
 
 void SoapyLoopback::setGain(const int direction, const size_t channel, const std::string &name, const double value)
+{
+    if (this->queueCommand(CMD_GAIN, direction, channel, name, value)) return;
+    this->applyGain(direction, channel, name, value);
+}
+
+void SoapyLoopback::applyGain(const int direction, const size_t channel, const std::string &name, const double value)
 {
     if ((name.length() >= 2) && (name.substr(0, 2) == "IF"))
     {
@@ -202,15 +437,17 @@ void SoapyLoopback::setGain(const int direction, const size_t channel, const std
             if ((stage_in < 1) || (stage_in > 6))
             {
                 throw std::runtime_error("Invalid IF stage, 1 or 1-6 for E4000");
+            } else {
+                stage = stage_in;
             }
         }
         IFGain[stage - 1] = value;
-        SoapySDR_logf(SOAPY_SDR_DEBUG, "Setting Loopback IF Gain for stage %d: %f", stage, IFGain[stage - 1]);    }
+        SoapySDR_logf(SOAPY_SDR_DEBUG, "Setting Loopback IF Gain for stage %d: %f", stage, value);    }
 
     if (name == "TUNER")
     {
         tunerGain = value;
-        SoapySDR_logf(SOAPY_SDR_DEBUG, "Setting Loopback Tuner Gain: %f", tunerGain);
+        SoapySDR_logf(SOAPY_SDR_DEBUG, "Setting Loopback Tuner Gain: %f", value);
     }
 }
 
@@ -272,10 +509,16 @@ void SoapyLoopback::setFrequency(
         const std::string &name,
         const double frequency,
         const SoapySDR::Kwargs &args)
+{
+    if (this->queueCommand(CMD_FREQUENCY, direction, channel, name, frequency, args)) return;
+    this->applyFrequency(direction, channel, name, frequency);
+}
+
+void SoapyLoopback::applyFrequency(const int direction, const size_t channel, const std::string &name, const double frequency)
 {
     if (name == "RF")
     {
-        centerFrequency = frequency;
+        centerFrequency[direction] = frequency;
     } else if (name == "CORR")
     {
         ppm = frequency;
@@ -289,10 +532,10 @@ double SoapyLoopback::getFrequency(const int direction, const size_t channel, co
 {
     if (name == "RF")
     {
-        return (double) centerFrequency;
+        return (double) centerFrequency[direction];
     } else if (name == "CORR")
     {
-        return (double) ppm;
+        return ppm;
     }
     return 0;
 }
@@ -326,7 +569,15 @@ SoapySDR::ArgInfoList SoapyLoopback::getFrequencyArgsInfo(const int direction, c
 {
     SoapySDR::ArgInfoList freqArgs;
 
-    // TODO: frequency arguments
+    SoapySDR::ArgInfo ticksArg;
+    ticksArg.key = "ticks";
+    ticksArg.value = "";
+    ticksArg.name = "Command Tick";
+    ticksArg.description = "Apply the tune when the sample counter reaches this tick.";
+    ticksArg.units = "samples";
+    ticksArg.type = SoapySDR::ArgInfo::INT;
+
+    freqArgs.push_back(ticksArg);
 
     return freqArgs;
 }
@@ -336,12 +587,23 @@ SoapySDR::ArgInfoList SoapyLoopback::getFrequencyArgsInfo(const int direction, c
  ******************************************************************/
 
 void SoapyLoopback::setSampleRate(const int direction, const size_t channel, const double rate)
+{
+    if (this->queueCommand(CMD_SAMPLE_RATE, direction, channel, "", rate)) return;
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        for (auto &stream : _rx_streams) stream->reset = true;
+    }
+    this->applySampleRate(rate);
+}
+
+void SoapyLoopback::applySampleRate(const double rate)
 {
     long long ns = SoapySDR::ticksToTimeNs(ticks, sampleRate);
     sampleRate = rate;
-    resetBuffer = true;
-    SoapySDR_logf(SOAPY_SDR_DEBUG, "Setting sample rate: %d", sampleRate);
+    SoapySDR_logf(SOAPY_SDR_DEBUG, "Setting sample rate: %d", int(rate));
     ticks = SoapySDR::timeNsToTicks(ns, sampleRate);
+    _rate_changed = true;
+    this->designChannelFilter();
 }
 
 double SoapyLoopback::getSampleRate(const int direction, const size_t channel) const
@@ -376,19 +638,24 @@ SoapySDR::RangeList SoapyLoopback::getSampleRateRange(const int direction, const
 void SoapyLoopback::setBandwidth(const int direction, const size_t channel, const double bw)
 {
     bandwidth = bw;
+    this->designChannelFilter();
 }
 
 double SoapyLoopback::getBandwidth(const int direction, const size_t channel) const
 {
-    if (bandwidth == 0) // auto / full bandwidth
-        return sampleRate;
-    return bandwidth;
+    return this->channelBandwidth();
 }
 
 std::vector<double> SoapyLoopback::listBandwidths(const int direction, const size_t channel) const
 {
     std::vector<double> results;
 
+    //the channel filter is designed for any width up to the sample rate
+    results.push_back(sampleRate*0.25);
+    results.push_back(sampleRate*0.5);
+    results.push_back(sampleRate*0.75);
+    results.push_back(sampleRate);
+
     return results;
 }
 
@@ -402,6 +669,42 @@ SoapySDR::RangeList SoapyLoopback::getBandwidthRange(const int direction, const
     return results;
 }
 
+double SoapyLoopback::channelBandwidth(void) const
+{
+    if (bandwidth == 0) // auto / full bandwidth
+        return sampleRate;
+    return std::min<uint32_t>(bandwidth, sampleRate);
+}
+
+void SoapyLoopback::designChannelFilter(void)
+{
+    std::lock_guard<std::mutex> lock(_filter_mutex);
+
+    //at the output rate with full bandwidth there is nothing to filter
+    _filter_decim = oversample;
+    if (oversample == 1 and channelBandwidth() >= sampleRate)
+    {
+        _filter_taps.clear();
+    }
+
+    //cutoff at half the bandwidth with a transition band of a tenth of
+    //the output rate, both normalized to the internal rate
+    else
+    {
+        const double rate = double(sampleRate)*oversample;
+        const auto key = std::make_pair(channelBandwidth()/2/rate, 0.1*sampleRate/rate);
+        auto it = _filter_cache.find(key);
+        if (it == _filter_cache.end())
+        {
+            it = _filter_cache.insert(std::make_pair(key, FirDecimator::design(key.first, key.second))).first;
+        }
+        _filter_taps = it->second;
+    }
+
+    SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback channel filter: %d taps, decimation %d", int(_filter_taps.size()), int(oversample));
+    _filter_changed = true;
+}
+
 /*******************************************************************
  * Time API
  ******************************************************************/
@@ -428,19 +731,165 @@ void SoapyLoopback::setTimeSource(const std::string &what)
 
 bool SoapyLoopback::hasHardwareTime(const std::string &what) const
 {
+    if (what == "pps") return _ref_source == "ext+pps";
     return what == "" || what == "sw_ticks";
 }
 
+long long SoapyLoopback::timebaseOffset(const long long timeNs) const
+{
+    //the latched time takes over on its pps edge
+    if (_pps_pending and timeNs >= _pps_edge) return _pps_time - _pps_edge;
+    return _timebase_offset;
+}
+
 long long SoapyLoopback::getHardwareTime(const std::string &what) const
 {
+    std::lock_guard<std::mutex> lock(_time_mutex);
+
+    //a device that follows the reference reads the shared clock,
+    //which keeps running between streams like a hardware counter
+    if (_timebase)
+    {
+        const long long now = _timebase->nowNs();
+        if (what == "pps")
+        {
+            const long long edge = SharedTimebase::lastPps(now);
+            return edge + this->timebaseOffset(edge);
+        }
+        return now + this->timebaseOffset(now);
+    }
     return SoapySDR::ticksToTimeNs(ticks, sampleRate);
 }
 
 void SoapyLoopback::setHardwareTime(const long long timeNs, const std::string &what)
 {
+    std::lock_guard<std::mutex> lock(_time_mutex);
+
+    //the time is latched on the next edge of the shared pps,
+    //so devices set within the same second agree on every tick
+    if (what == "pps")
+    {
+        if (not _timebase or _ref_source != "ext+pps")
+        {
+            throw std::runtime_error("SoapyLoopback::setHardwareTime(pps) requires the ext+pps clock source");
+        }
+        _pps_edge = SharedTimebase::nextPps(_timebase->nowNs());
+        _pps_time = timeNs;
+        _pps_pending = true;
+        return;
+    }
+
+    if (_timebase)
+    {
+        _timebase_offset = timeNs - _timebase->nowNs();
+        _pps_pending = false;
+    }
     ticks = SoapySDR::timeNsToTicks(timeNs, sampleRate);
 }
 
+void SoapyLoopback::setCommandTime(const long long timeNs, const std::string &what)
+{
+    //a time of 0 clears the command time, later calls apply immediately
+    commandTime = timeNs;
+}
+
+/*******************************************************************
+ * Timed commands
+ ******************************************************************/
+
+bool SoapyLoopback::queueCommand(
+        const CommandType type,
+        const int direction,
+        const size_t channel,
+        const std::string &name,
+        const double value,
+        const SoapySDR::Kwargs &args)
+{
+    Command cmd;
+    cmd.type = type;
+    cmd.direction = direction;
+    cmd.channel = channel;
+    cmd.name = name;
+    cmd.value = value;
+
+    //the ticks arg takes precedence over the command time
+    if (args.count("ticks") != 0)
+    {
+        try
+        {
+            cmd.timeNs = SoapySDR::ticksToTimeNs(std::stoll(args.at("ticks")), sampleRate);
+        }
+        catch (const std::invalid_argument &)
+        {
+            SoapySDR_logf(SOAPY_SDR_ERROR, "Loopback invalid command ticks '%s'", args.at("ticks").c_str());
+            return false;
+        }
+    }
+    else if (commandTime != 0)
+    {
+        cmd.timeNs = commandTime;
+    }
+    else return false;
+
+    //keep the queue sorted, commands on the same tick run in call order
+    std::lock_guard<std::mutex> lock(_cmd_mutex);
+    auto it = std::upper_bound(_cmds.begin(), _cmds.end(), cmd,
+        [](const Command &a, const Command &b){return a.timeNs < b.timeNs;});
+    _cmds.insert(it, cmd);
+    return true;
+}
+
+size_t SoapyLoopback::runCommands(const long long tick, const size_t numElems, const bool boundary)
+{
+    std::lock_guard<std::mutex> lock(_cmd_mutex);
+
+    //commands are due at the tick of their time at the current rate
+    auto due = [this](const Command &cmd){return SoapySDR::timeNsToTicks(cmd.timeNs, sampleRate);};
+
+    //apply everything that is due at this tick; a rate change cannot
+    //split a buffer, it waits for the next one and the other commands
+    //due in this one go ahead of it
+    long long now = tick;
+    for (auto it = _cmds.begin(); it != _cmds.end() and due(*it) <= now;)
+    {
+        if (it->type == CMD_SAMPLE_RATE and not boundary)
+        {
+            ++it;
+            continue;
+        }
+        this->applyCommand(*it);
+        if (it->type == CMD_SAMPLE_RATE) now = ticks;
+        it = _cmds.erase(it);
+    }
+
+    //number of samples that can be rendered before the next command
+    //other than a rate change
+    for (const auto &cmd : _cmds)
+    {
+        if (cmd.type == CMD_SAMPLE_RATE) continue;
+        const long long next = due(cmd);
+        if (next >= now + (long long)numElems) break;
+        return size_t(next - now);
+    }
+    return numElems;
+}
+
+void SoapyLoopback::applyCommand(const Command &cmd)
+{
+    SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback timed command at %lld ns", cmd.timeNs);
+    switch (cmd.type)
+    {
+    case CMD_FREQUENCY: this->applyFrequency(cmd.direction, cmd.channel, cmd.name, cmd.value); break;
+    case CMD_GAIN: this->applyGain(cmd.direction, cmd.channel, cmd.name, cmd.value); break;
+    case CMD_SAMPLE_RATE:
+        //the readers start over like on an immediate rate change; this runs
+        //in the producer, and the rings only change with it stopped
+        for (auto &ring : _rx_rings) for (auto *reader : ring->readers) reader->reset = true;
+        this->applySampleRate(cmd.value);
+        break;
+    }
+}
+
 /*******************************************************************
  * Settings API
  ******************************************************************/
@@ -494,6 +943,195 @@ SoapySDR::ArgInfoList SoapyLoopback::getSettingInfo(void) const
 
     setArgs.push_back(digitalAGCArg);
 
+    SoapySDR::ArgInfo agcReferenceArg;
+
+    agcReferenceArg.key = "agc_reference";
+    agcReferenceArg.value = "-20";
+    agcReferenceArg.name = "AGC Reference";
+    agcReferenceArg.description = "Output power the AGC settles to";
+    agcReferenceArg.units = "dBFS";
+    agcReferenceArg.type = SoapySDR::ArgInfo::FLOAT;
+    agcReferenceArg.range = SoapySDR::Range(-60, 0);
+
+    setArgs.push_back(agcReferenceArg);
+
+    SoapySDR::ArgInfo agcAttackArg;
+
+    agcAttackArg.key = "agc_attack";
+    agcAttackArg.value = "1";
+    agcAttackArg.name = "AGC Attack";
+    agcAttackArg.description = "Time constant of the AGC when the level is above the reference";
+    agcAttackArg.units = "ms";
+    agcAttackArg.type = SoapySDR::ArgInfo::FLOAT;
+
+    setArgs.push_back(agcAttackArg);
+
+    SoapySDR::ArgInfo agcDecayArg;
+
+    agcDecayArg.key = "agc_decay";
+    agcDecayArg.value = "100";
+    agcDecayArg.name = "AGC Decay";
+    agcDecayArg.description = "Time constant of the AGC when the level is below the reference";
+    agcDecayArg.units = "ms";
+    agcDecayArg.type = SoapySDR::ArgInfo::FLOAT;
+
+    setArgs.push_back(agcDecayArg);
+
+    SoapySDR::ArgInfo impairmentsArg;
+
+    impairmentsArg.key = "impairments";
+    impairmentsArg.value = "false";
+    impairmentsArg.name = "Impairments";
+    impairmentsArg.description = "Apply gain, frequency offset, fading and noise to the loopback path";
+    impairmentsArg.type = SoapySDR::ArgInfo::BOOL;
+
+    setArgs.push_back(impairmentsArg);
+
+    SoapySDR::ArgInfo snrArg;
+
+    snrArg.key = "snr";
+    snrArg.value = "inf";
+    snrArg.name = "SNR";
+    snrArg.description = "Power of a full scale signal over the added white noise, inf disables the noise";
+    snrArg.units = "dB";
+    snrArg.type = SoapySDR::ArgInfo::FLOAT;
+
+    setArgs.push_back(snrArg);
+
+    SoapySDR::ArgInfo fadingArg;
+
+    fadingArg.key = "fading";
+    fadingArg.value = "none";
+    fadingArg.name = "Fading";
+    fadingArg.description = "Flat fading model of the loopback channel";
+    fadingArg.type = SoapySDR::ArgInfo::STRING;
+    fadingArg.options.push_back("none");
+    fadingArg.optionNames.push_back("None");
+    fadingArg.options.push_back("rayleigh");
+    fadingArg.optionNames.push_back("Rayleigh");
+    fadingArg.options.push_back("rician");
+    fadingArg.optionNames.push_back("Rician");
+
+    setArgs.push_back(fadingArg);
+
+    SoapySDR::ArgInfo ricianKArg;
+
+    ricianKArg.key = "rician_k";
+    ricianKArg.value = "10";
+    ricianKArg.name = "Rician K";
+    ricianKArg.description = "Power of the line of sight path over the scattered paths";
+    ricianKArg.units = "dB";
+    ricianKArg.type = SoapySDR::ArgInfo::FLOAT;
+
+    setArgs.push_back(ricianKArg);
+
+    SoapySDR::ArgInfo dopplerArg;
+
+    dopplerArg.key = "doppler";
+    dopplerArg.value = "10";
+    dopplerArg.name = "Doppler";
+    dopplerArg.description = "Maximum Doppler shift of the fading model";
+    dopplerArg.units = "Hz";
+    dopplerArg.type = SoapySDR::ArgInfo::FLOAT;
+
+    setArgs.push_back(dopplerArg);
+
+    SoapySDR::ArgInfo iqGainArg;
+
+    iqGainArg.key = "iq_gain";
+    iqGainArg.value = "0";
+    iqGainArg.name = "IQ Gain Imbalance";
+    iqGainArg.description = "Gain of the Q branch over the I branch, undone by an IQ balance of the same gain";
+    iqGainArg.units = "dB";
+    iqGainArg.type = SoapySDR::ArgInfo::FLOAT;
+
+    setArgs.push_back(iqGainArg);
+
+    SoapySDR::ArgInfo iqPhaseArg;
+
+    iqPhaseArg.key = "iq_phase";
+    iqPhaseArg.value = "0";
+    iqPhaseArg.name = "IQ Phase Imbalance";
+    iqPhaseArg.description = "Phase error of the Q branch, undone by an IQ balance of the same phase";
+    iqPhaseArg.units = "degrees";
+    iqPhaseArg.type = SoapySDR::ArgInfo::FLOAT;
+    iqPhaseArg.range = SoapySDR::Range(-45, 45);
+
+    setArgs.push_back(iqPhaseArg);
+
+    SoapySDR::ArgInfo ppmWalkArg;
+
+    ppmWalkArg.key = "ppm_walk";
+    ppmWalkArg.value = "0";
+    ppmWalkArg.name = "Clock Walk";
+    ppmWalkArg.description = "Random walk of the sample clock error on top of the frequency correction";
+    ppmWalkArg.units = "ppm/sqrt(s)";
+    ppmWalkArg.type = SoapySDR::ArgInfo::FLOAT;
+
+    setArgs.push_back(ppmWalkArg);
+
+    SoapySDR::ArgInfo delayArg;
+
+    delayArg.key = "loopback_delay";
+    delayArg.value = "0";
+    delayArg.name = "Loopback Delay";
+    delayArg.description = "Latency from the transmit timeline to the receive timeline";
+    delayArg.units = "samples";
+    delayArg.type = SoapySDR::ArgInfo::INT;
+
+    setArgs.push_back(delayArg);
+
+    SoapySDR::ArgInfo multipathArg;
+
+    multipathArg.key = "multipath";
+    multipathArg.value = "";
+    multipathArg.name = "Multipath";
+    multipathArg.description = "Paths besides the direct one, as comma separated delay:gain[:phase] "
+        "in samples after the direct path, dB and degrees";
+    multipathArg.type = SoapySDR::ArgInfo::STRING;
+
+    setArgs.push_back(multipathArg);
+
+    SoapySDR::ArgInfo oversampleArg;
+
+    oversampleArg.key = "oversample";
+    oversampleArg.value = "1";
+    oversampleArg.name = "Oversampling";
+    oversampleArg.description = "Internal rate as a multiple of the sample rate, decimated by the channel filter";
+    oversampleArg.type = SoapySDR::ArgInfo::INT;
+    oversampleArg.range = SoapySDR::Range(1, 64);
+
+    setArgs.push_back(oversampleArg);
+
+    SoapySDR::ArgInfo prbsArg;
+
+    prbsArg.key = "prbs";
+    prbsArg.value = "off";
+    prbsArg.name = "PRBS Test Pattern";
+    prbsArg.description = "Bit sequence sent in place of the transmitter and checked in every RX stream";
+    prbsArg.type = SoapySDR::ArgInfo::STRING;
+    prbsArg.options.push_back("off");
+    prbsArg.optionNames.push_back("Off");
+    prbsArg.options.push_back("15");
+    prbsArg.optionNames.push_back("PRBS-15");
+    prbsArg.options.push_back("23");
+    prbsArg.optionNames.push_back("PRBS-23");
+    prbsArg.options.push_back("31");
+    prbsArg.optionNames.push_back("PRBS-31");
+
+    setArgs.push_back(prbsArg);
+
+    SoapySDR::ArgInfo eventFdArg;
+
+    eventFdArg.key = "rx_event_fd";
+    eventFdArg.value = "-1";
+    eventFdArg.name = "RX Event Descriptor";
+    eventFdArg.description = "Read only descriptor that polls readable when the first RX stream has buffers; "
+        "read with a zero timeout until SOAPY_SDR_TIMEOUT before polling again";
+    eventFdArg.type = SoapySDR::ArgInfo::INT;
+
+    setArgs.push_back(eventFdArg);
+
     SoapySDR_logf(SOAPY_SDR_DEBUG, "SETARGS?");
 
     return setArgs;
@@ -531,6 +1169,126 @@ void SoapyLoopback::writeSetting(const std::string &key, const std::string &valu
         SoapySDR_logf(SOAPY_SDR_DEBUG, "RTL-SDR digital agc mode: %s", digitalAGC ? "true" : "false");
         //rtlsdr_set_agc_mode(dev, digitalAGC ? 1 : 0);
     }
+    else if (key == "impairments")
+    {
+        impairments = (value == "true") ? true : false;
+        SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback impairments: %s", impairments ? "true" : "false");
+    }
+    else if (key == "fading")
+    {
+        if (value == "none") fading = FADING_NONE;
+        else if (value == "rayleigh") fading = FADING_RAYLEIGH;
+        else if (value == "rician") fading = FADING_RICIAN;
+        else
+        {
+            SoapySDR_logf(SOAPY_SDR_ERROR, "Loopback invalid fading model '%s', [none, rayleigh, rician]", value.c_str());
+            return;
+        }
+        SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback fading model: %s", value.c_str());
+    }
+    else if (key == "prbs")
+    {
+        if (value == "off") prbsOrder = 0;
+        else if (value == "15" or value == "23" or value == "31") prbsOrder = std::stoi(value);
+        else
+        {
+            SoapySDR_logf(SOAPY_SDR_ERROR, "Loopback invalid PRBS '%s', [off, 15, 23, 31]", value.c_str());
+            return;
+        }
+        SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback PRBS: %s", value.c_str());
+    }
+    else if (key == "oversample")
+    {
+        int oversample_in = 0;
+        try
+        {
+            oversample_in = std::stoi(value);
+        }
+        catch (const std::invalid_argument &) {}
+        if (oversample_in < 1 or oversample_in > 64)
+        {
+            SoapySDR_logf(SOAPY_SDR_ERROR, "Loopback invalid oversampling '%s', [1, 64]", value.c_str());
+            return;
+        }
+        oversample = oversample_in;
+        this->designChannelFilter();
+    }
+    else if (key == "loopback_delay")
+    {
+        long long delay_in = -1;
+        try
+        {
+            delay_in = std::stoll(value);
+        }
+        catch (const std::invalid_argument &) {}
+        //the untimed transmitter writes that far ahead of the reader
+        if (delay_in < 0 or delay_in > DEFAULT_AIR_LENGTH/4)
+        {
+            SoapySDR_logf(SOAPY_SDR_ERROR, "Loopback invalid delay '%s', [0, %d]", value.c_str(), DEFAULT_AIR_LENGTH/4);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_air_mutex);
+        loopbackDelay = size_t(delay_in);
+        _air_restart = true;
+    }
+    else if (key == "multipath")
+    {
+        //the direct path comes first with unity gain
+        std::vector<DelayTap> taps(1, DelayTap{0, 1.0f});
+        std::stringstream ss(value);
+        std::string path;
+        while (std::getline(ss, path, ','))
+        {
+            if (path.find_first_not_of(" ") == std::string::npos) continue;
+            double delay = -1.0, gain = 0.0, phase = 0.0;
+            const int n = std::sscanf(path.c_str(), "%lf:%lf:%lf", &delay, &gain, &phase);
+            if (n < 2 or delay < 0 or delay > DEFAULT_AIR_LENGTH/4)
+            {
+                SoapySDR_logf(SOAPY_SDR_ERROR, "Loopback invalid multipath '%s', delay:gain[:phase]", path.c_str());
+                return;
+            }
+            taps.push_back(DelayTap{size_t(delay), std::polar(float(std::pow(10.0, gain/20)), float(phase*M_PI/180))});
+        }
+        std::lock_guard<std::mutex> lock(_air_mutex);
+        multipath = value;
+        _air.setTaps(taps);
+        _air_restart = true;
+    }
+    else if (key == "agc_reference" or key == "agc_attack" or key == "agc_decay")
+    {
+        double v = 0.0;
+        try
+        {
+            v = std::stod(value);
+        }
+        catch (const std::invalid_argument &) {
+            SoapySDR_logf(SOAPY_SDR_ERROR, "Loopback invalid %s '%s'", key.c_str(), value.c_str());
+            return;
+        }
+        if (key == "agc_reference") agcReference = std::min(v, 0.0);
+        if (key == "agc_attack") agcAttack = std::max(v, 0.0)/1e3;
+        if (key == "agc_decay") agcDecay = std::max(v, 0.0)/1e3;
+        SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback %s: %f", key.c_str(), v);
+    }
+    else if (key == "snr" or key == "rician_k" or key == "doppler" or key == "ppm_walk" or key == "iq_gain" or key == "iq_phase")
+    {
+        double v = 0.0;
+        try
+        {
+            v = std::stod(value);
+        }
+        catch (const std::invalid_argument &) {
+            SoapySDR_logf(SOAPY_SDR_ERROR, "Loopback invalid %s '%s'", key.c_str(), value.c_str());
+            return;
+        }
+        if (key == "snr") snr = v;
+        if (key == "rician_k") ricianK = v;
+        if (key == "doppler") doppler = v;
+        if (key == "ppm_walk") ppmWalk = v;
+        if (key == "iq_gain") iqGain = v;
+        if (key == "iq_phase") iqPhase = std::max(-45.0, std::min(45.0, v));
+        SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback %s: %f", key.c_str(), v);
+    }
 }
 
 std::string SoapyLoopback::readSetting(const std::string &key) const
@@ -543,12 +1301,81 @@ std::string SoapyLoopback::readSetting(const std::string &key) const
         return offsetMode?"true":"false";
     } else if (key == "digital_agc") {
         return digitalAGC?"true":"false";
+    } else if (key == "loopback_delay") {
+        return std::to_string(loopbackDelay);
+    } else if (key == "multipath") {
+        return multipath;
+    } else if (key == "agc_reference") {
+        return std::to_string(agcReference);
+    } else if (key == "agc_attack") {
+        return std::to_string(agcAttack*1e3);
+    } else if (key == "agc_decay") {
+        return std::to_string(agcDecay*1e3);
+    } else if (key == "impairments") {
+        return impairments?"true":"false";
+    } else if (key == "snr") {
+        return std::to_string(snr);
+    } else if (key == "fading") {
+        if (fading == FADING_RAYLEIGH) return "rayleigh";
+        if (fading == FADING_RICIAN) return "rician";
+        return "none";
+    } else if (key == "rician_k") {
+        return std::to_string(ricianK);
+    } else if (key == "doppler") {
+        return std::to_string(doppler);
+    } else if (key == "ppm_walk") {
+        return std::to_string(ppmWalk);
+    } else if (key == "iq_gain") {
+        return std::to_string(iqGain);
+    } else if (key == "iq_phase") {
+        return std::to_string(iqPhase);
+    } else if (key == "oversample") {
+        return std::to_string(oversample);
+    } else if (key == "prbs") {
+        return (prbsOrder == 0) ? "off" : std::to_string(prbsOrder);
+    } else if (key == "rx_event_fd") {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        return std::to_string(_rx_streams.empty() ? -1 : _rx_streams.front()->ready.fd());
     }
 
     SoapySDR_logf(SOAPY_SDR_WARNING, "Unknown setting '%s'", key.c_str());
     return "";
 }
 
+SoapySDR::ArgInfoList SoapyLoopback::getSettingInfo(const int direction, const size_t channel) const
+{
+    SoapySDR::ArgInfoList setArgs;
+    if (direction != SOAPY_SDR_RX) return setArgs;
+
+    SoapySDR::ArgInfo eventFdArg;
+
+    eventFdArg.key = "event_fd";
+    eventFdArg.value = "-1";
+    eventFdArg.name = "Event Descriptor";
+    eventFdArg.description = "Read only descriptor that polls readable when the RX stream of this channel has buffers; "
+        "read with a zero timeout until SOAPY_SDR_TIMEOUT before polling again";
+    eventFdArg.type = SoapySDR::ArgInfo::INT;
+
+    setArgs.push_back(eventFdArg);
+
+    return setArgs;
+}
+
+std::string SoapyLoopback::readSetting(const int direction, const size_t channel, const std::string &key) const
+{
+    if (direction == SOAPY_SDR_RX and key == "event_fd")
+    {
+        //the stream set up on the channel, attached readers have
+        //their own descriptor through getRxEventFd
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        const auto *ring = this->findRxRing(channel);
+        return std::to_string((ring == nullptr or ring->readers.empty()) ? -1 : ring->readers.front()->ready.fd());
+    }
+
+    SoapySDR_logf(SOAPY_SDR_WARNING, "Unknown channel setting '%s'", key.c_str());
+    return "";
+}
+
 /*******************************************************************
  * Clocking API
  ******************************************************************/
@@ -589,6 +1416,25 @@ std::vector<std::string> SoapyLoopback::listClockSources(void) const
 
 void SoapyLoopback::setClockSource(const std::string &source)
 {
+    std::lock_guard<std::mutex> lock(_time_mutex);
+
+    //virtual time has no wall clock to share
+    const bool external = (source == "external" or source == "ext+pps");
+    if (external and virtualTime)
+    {
+        SoapySDR_logf(SOAPY_SDR_WARNING, "Loopback clock source %s ignored in virtual time", source.c_str());
+    }
+    else if (external and not _timebase)
+    {
+        //lock without a jump in the device time
+        _timebase = SharedTimebase::get(_timebase_name);
+        _timebase_offset = SoapySDR::ticksToTimeNs(ticks, sampleRate) - _timebase->nowNs();
+    }
+    else if (not external and _timebase)
+    {
+        _timebase.reset();
+    }
+    if (source != "ext+pps") _pps_pending = false;
     _ref_source = source;
 }
 
@@ -606,8 +1452,22 @@ std::vector<std::string> SoapyLoopback::listSensors(void) const
 {
 	std::vector<std::string> sensors;
 	sensors.push_back("clock_locked");
+	sensors.push_back("ref_locked");
 	sensors.push_back("lms7_temp");
 	sensors.push_back("board_temp");
+	if (_bridge_tx or _bridge_rx)
+	{
+		sensors.push_back("bridge_frames");
+		sensors.push_back("bridge_syscalls");
+		sensors.push_back("bridge_dropped");
+	}
+	if (_replay)
+	{
+		sensors.push_back("replay_chunks");
+		sensors.push_back("replay_late");
+		sensors.push_back("replay_errors");
+		sensors.push_back("replay_offset");
+	}
 	return sensors;
 }
 
@@ -622,6 +1482,14 @@ SoapySDR::ArgInfo SoapyLoopback::getSensorInfo(const std::string &name) const
 		info.value = "false";
 		info.description = "CGEN clock is locked, good VCO selection.";
 	}
+	else if (name == "ref_locked")
+	{
+		info.key = "ref_locked";
+		info.name = "Reference Locked";
+		info.type = SoapySDR::ArgInfo::BOOL;
+		info.value = "false";
+		info.description = "The sample clock follows the reference shared by the devices in this process.";
+	}
 	else if (name == "lms7_temp")
 	{
 		info.key = "lms7_temp";
@@ -640,6 +1508,63 @@ SoapySDR::ArgInfo SoapyLoopback::getSensorInfo(const std::string &name) const
 		info.units = "C";
 		info.description = "The temperature of the XTRX board in degrees C.";
 	}
+	else if (name == "bridge_frames")
+	{
+		info.key = "bridge_frames";
+		info.name = "Bridge Frames";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.description = "Frames sent and received over the socket bridge.";
+	}
+	else if (name == "bridge_syscalls")
+	{
+		info.key = "bridge_syscalls";
+		info.name = "Bridge Syscalls";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.description = "sendmmsg and recvmmsg calls made for those frames.";
+	}
+	else if (name == "bridge_dropped")
+	{
+		info.key = "bridge_dropped";
+		info.name = "Bridge Dropped";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.description = "Frames lost to a closed or stalled receiver, malformed, or outside the receive delay line.";
+	}
+	else if (name == "replay_chunks")
+	{
+		info.key = "replay_chunks";
+		info.name = "Replay Chunks";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.description = "Chunks of the capture written into the air.";
+	}
+	else if (name == "replay_late")
+	{
+		info.key = "replay_late";
+		info.name = "Replay Late";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.description = "Times the decompression fell behind the receiver and the capture was moved on to the read position.";
+	}
+	else if (name == "replay_errors")
+	{
+		info.key = "replay_errors";
+		info.name = "Replay Errors";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.description = "Chunks that failed to read or decompress and played as silence.";
+	}
+	else if (name == "replay_offset")
+	{
+		info.key = "replay_offset";
+		info.name = "Replay Offset";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.units = "ticks";
+		info.description = "Device tick minus capture tick of the replay, which moves on each time it was late.";
+	}
 	return info;
 }
 
@@ -649,6 +1574,11 @@ std::string SoapyLoopback::readSensor(const std::string &name) const
 	{
 		return "true";
 	}
+	else if (name == "ref_locked")
+	{
+		std::lock_guard<std::mutex> lock(_time_mutex);
+		return _timebase ? "true" : "false";
+	}
 	else if (name == "lms7_temp")
 	{
 		return "1.0";
@@ -657,14 +1587,58 @@ std::string SoapyLoopback::readSensor(const std::string &name) const
 	{
 		return "1.0";
 	}
+	else if (name == "bridge_frames" or name == "bridge_syscalls" or name == "bridge_dropped")
+	{
+		unsigned long long count = 0;
+		for (const auto *bridge : {_bridge_tx.get(), _bridge_rx.get()})
+		{
+			if (bridge == nullptr) continue;
+			if (name == "bridge_frames") count += bridge->frames();
+			if (name == "bridge_syscalls") count += bridge->syscalls();
+			if (name == "bridge_dropped") count += bridge->dropped();
+		}
+		return std::to_string(count);
+	}
+	else if (name == "replay_chunks" and _replay)
+	{
+		return std::to_string(_replay_chunks.load());
+	}
+	else if (name == "replay_late" and _replay)
+	{
+		return std::to_string(_replay_late.load());
+	}
+	else if (name == "replay_errors" and _replay)
+	{
+		return std::to_string(_replay->errors());
+	}
+	else if (name == "replay_offset" and _replay)
+	{
+		return std::to_string(_replay_offset.load());
+	}
 
 	throw std::runtime_error("SoapyLoopback::readSensor("+name+") - unknown sensor name");
 }
 
-std::vector<std::string> SoapyLoopback::listSensors(const int /*direction*/, const size_t /*channel*/) const
+std::vector<std::string> SoapyLoopback::listSensors(const int direction, const size_t /*channel*/) const
 {
 	std::vector<std::string> sensors;
 	sensors.push_back("lo_locked");
+	if (direction == SOAPY_SDR_RX) sensors.push_back("agc_gain");
+	if (direction == SOAPY_SDR_RX) sensors.push_back("ring_buffers");
+	if (direction == SOAPY_SDR_RX)
+	{
+		sensors.push_back("seq_gaps");
+		sensors.push_back("seq_lost");
+		sensors.push_back("prbs_lock");
+		sensors.push_back("prbs_bits");
+		sensors.push_back("prbs_errors");
+		sensors.push_back("prbs_slips");
+		sensors.push_back("prbs_rate");
+		sensors.push_back("level_rms");
+		sensors.push_back("level_peak");
+		sensors.push_back("level_dc");
+		sensors.push_back("level_clips");
+	}
 	return sensors;
 }
 
@@ -679,16 +1653,198 @@ SoapySDR::ArgInfo SoapyLoopback::getSensorInfo(const int /*direction*/, const si
 		info.value = "false";
 		info.description = "LO synthesizer is locked, good VCO selection.";
 	}
+	else if (name == "agc_gain")
+	{
+		info.key = "agc_gain";
+		info.name = "AGC Gain";
+		info.type = SoapySDR::ArgInfo::FLOAT;
+		info.value = "0.0";
+		info.units = "dB";
+		info.description = "Gain of the digital AGC, zero when the AGC is off.";
+	}
+	else if (name == "ring_buffers")
+	{
+		info.key = "ring_buffers";
+		info.name = "Ring Buffers";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.description = "Buffers in the receive ring, which an adaptive ring changes while streaming.";
+	}
+	else if (name == "seq_gaps")
+	{
+		info.key = "seq_gaps";
+		info.name = "Sequence Gaps";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.description = "Breaks in the buffer numbering seen by the readers of the channel.";
+	}
+	else if (name == "seq_lost")
+	{
+		info.key = "seq_lost";
+		info.name = "Lost Samples";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.units = "samples";
+		info.description = "Samples in the buffers those gaps skipped.";
+	}
+	else if (name == "prbs_lock")
+	{
+		info.key = "prbs_lock";
+		info.name = "PRBS Lock";
+		info.type = SoapySDR::ArgInfo::BOOL;
+		info.value = "false";
+		info.description = "Every reader of the channel found the test pattern.";
+	}
+	else if (name == "prbs_bits")
+	{
+		info.key = "prbs_bits";
+		info.name = "PRBS Bits";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.units = "bits";
+		info.description = "Bits of the test pattern checked by the readers of the channel.";
+	}
+	else if (name == "prbs_errors")
+	{
+		info.key = "prbs_errors";
+		info.name = "PRBS Bit Errors";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.units = "bits";
+		info.description = "Checked bits that differ from the test pattern.";
+	}
+	else if (name == "prbs_slips")
+	{
+		info.key = "prbs_slips";
+		info.name = "PRBS Slips";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.description = "Times a reader lost the test pattern and looked for it again.";
+	}
+	else if (name == "prbs_rate")
+	{
+		info.key = "prbs_rate";
+		info.name = "PRBS Throughput";
+		info.type = SoapySDR::ArgInfo::FLOAT;
+		info.value = "0.0";
+		info.units = "Mbit/s";
+		info.description = "Bits checked per second by the readers of the channel together.";
+	}
+	else if (name == "level_rms")
+	{
+		info.key = "level_rms";
+		info.name = "RMS Level";
+		info.type = SoapySDR::ArgInfo::FLOAT;
+		info.value = "-inf";
+		info.units = "dBFS";
+		info.description = "Mean power of the received samples over the last window, as read by readStream or direct buffer access.";
+	}
+	else if (name == "level_peak")
+	{
+		info.key = "level_peak";
+		info.name = "Peak Level";
+		info.type = SoapySDR::ArgInfo::FLOAT;
+		info.value = "-inf";
+		info.units = "dBFS";
+		info.description = "Largest sample magnitude over the last window.";
+	}
+	else if (name == "level_dc")
+	{
+		info.key = "level_dc";
+		info.name = "DC Level";
+		info.type = SoapySDR::ArgInfo::FLOAT;
+		info.value = "-inf";
+		info.units = "dBFS";
+		info.description = "Magnitude of the mean sample over the last window, after the DC offset correction.";
+	}
+	else if (name == "level_clips")
+	{
+		info.key = "level_clips";
+		info.name = "Clipped Samples";
+		info.type = SoapySDR::ArgInfo::INT;
+		info.value = "0";
+		info.units = "samples";
+		info.description = "Samples with I or Q at the full scale of the stream format, clipped by the ADC or by the conversion.";
+	}
 	return info;
 }
 
-std::string SoapyLoopback::readSensor(const int /*direction*/, const size_t /*channel*/, const std::string &name) const
+std::string SoapyLoopback::readSensor(const int direction, const size_t channel, const std::string &name) const
 {
 
 	if (name == "lo_locked")
 	{
 		return "true";
 	}
+	else if (name == "agc_gain" and direction == SOAPY_SDR_RX and channel < _rx_agc.size())
+	{
+		return std::to_string(_rx_agc[channel].gainDb());
+	}
+	else if (name == "ring_buffers" and direction == SOAPY_SDR_RX)
+	{
+		std::lock_guard<std::mutex> lock(_rx_mutex);
+		const auto *ring = this->findRxRing(channel);
+		return std::to_string(ring == nullptr ? 0 : size_t(ring->numBuffers));
+	}
+	else if ((name == "seq_gaps" or name == "seq_lost") and direction == SOAPY_SDR_RX)
+	{
+		//summed over the readers of the ring that has the channel
+		std::lock_guard<std::mutex> lock(_rx_mutex);
+		const auto *ring = this->findRxRing(channel);
+		unsigned long long count = 0;
+		if (ring != nullptr) for (const auto *reader : ring->readers)
+		{
+			if (name == "seq_gaps") count += reader->gaps;
+			if (name == "seq_lost") count += reader->lost;
+		}
+		return std::to_string(count);
+	}
+	else if ((name == "prbs_lock" or name == "prbs_bits" or name == "prbs_errors" or name == "prbs_slips" or name == "prbs_rate") and direction == SOAPY_SDR_RX)
+	{
+		//the checkers of the channel in every reader of its ring
+		std::lock_guard<std::mutex> lock(_rx_mutex);
+		const auto *ring = this->findRxRing(channel);
+		bool locked = ring != nullptr and not ring->readers.empty();
+		unsigned long long count = 0;
+		double rate = 0.0;
+		if (ring != nullptr) for (const auto *reader : ring->readers)
+		{
+			for (size_t i = 0; i < ring->channels.size() and i < reader->prbs.size(); i++)
+			{
+				if (ring->channels[i] != channel) continue;
+				const auto &checker = reader->prbs[i];
+				locked = locked and checker.locked();
+				if (name == "prbs_bits") count += checker.bits();
+				if (name == "prbs_errors") count += checker.errors();
+				if (name == "prbs_slips") count += checker.slips();
+				rate += checker.rate();
+			}
+		}
+		if (name == "prbs_lock") return locked ? "true" : "false";
+		if (name == "prbs_rate") return std::to_string(rate/1e6);
+		return std::to_string(count);
+	}
+	else if ((name == "level_rms" or name == "level_peak" or name == "level_dc" or name == "level_clips") and direction == SOAPY_SDR_RX)
+	{
+		//the readers of a ring measure the same samples,
+		//the one that measured the most of them is shown
+		std::lock_guard<std::mutex> lock(_rx_mutex);
+		const auto *ring = this->findRxRing(channel);
+		const LevelMeter *meter = nullptr;
+		if (ring != nullptr) for (const auto *reader : ring->readers)
+		{
+			for (size_t i = 0; i < ring->channels.size() and i < reader->levels.size(); i++)
+			{
+				if (ring->channels[i] != channel) continue;
+				if (meter == nullptr or reader->levels[i].samples() > meter->samples()) meter = &reader->levels[i];
+			}
+		}
+		if (name == "level_clips") return std::to_string(meter == nullptr ? 0 : meter->clips());
+		if (meter == nullptr) return std::to_string(-INFINITY);
+		if (name == "level_rms") return std::to_string(meter->rmsDb());
+		if (name == "level_peak") return std::to_string(meter->peakDb());
+		return std::to_string(meter->dcDb());
+	}
 
 	throw std::runtime_error("SoapyLoopback::readSensor("+name+") - unknown sensor name");
 }
@@ -24,6 +24,19 @@
  */
 #pragma once
 
+#include "Resampler.hpp"
+#include "Decimator.hpp"
+#include "Channelizer.hpp"
+#include "Agc.hpp"
+#include "Delay.hpp"
+#include "BoundedQueue.hpp"
+#include "Timebase.hpp"
+#include "ReadyEvent.hpp"
+#include "Bridge.hpp"
+#include "Replay.hpp"
+#include "Prbs.hpp"
+#include "Level.hpp"
+#include "LoopbackPush.hpp"
 #include <SoapySDR/Device.hpp>
 #include <SoapySDR/Logger.h>
 #include <SoapySDR/Types.h>
@@ -32,12 +45,19 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
 
 #define DEFAULT_BUFFER_LENGTH (16 * 32 * 512)
 #define DEFAULT_NUM_BUFFERS 15
 #define BYTES_PER_SAMPLE 2
+#define DEFAULT_AIR_LENGTH (1 << 20)
+#define STATUS_QUEUE_LENGTH 1024
+#define BURST_QUEUE_LENGTH 1024
 
-class SoapyLoopback: public SoapySDR::Device
+class SoapyLoopback: public SoapySDR::Device, public SoapyLoopbackPush
 {
 public:
     SoapyLoopback(const SoapySDR::Kwargs &args);
@@ -95,6 +115,25 @@ public:
             long long &timeNs,
             const long timeoutUs = 100000);
 
+    int writeStream(
+            SoapySDR::Stream *stream,
+            const void * const *buffs,
+            const size_t numElems,
+            int &flags,
+            const long long timeNs = 0,
+            const long timeoutUs = 100000);
+
+    int readStreamStatus(
+            SoapySDR::Stream *stream,
+            size_t &chanMask,
+            int &flags,
+            long long &timeNs,
+            const long timeoutUs = 100000);
+
+    int setRxCallback(SoapySDR::Stream *stream, RxCallback callback, void *user);
+
+    int getRxEventFd(SoapySDR::Stream *stream) const;
+
     /*******************************************************************
      * Direct buffer access API
      ******************************************************************/
@@ -131,6 +170,22 @@ public:
 
     bool hasDCOffsetMode(const int direction, const size_t channel) const;
 
+    void setDCOffsetMode(const int direction, const size_t channel, const bool automatic);
+
+    bool getDCOffsetMode(const int direction, const size_t channel) const;
+
+    bool hasDCOffset(const int direction, const size_t channel) const;
+
+    void setDCOffset(const int direction, const size_t channel, const std::complex<double> &offset);
+
+    std::complex<double> getDCOffset(const int direction, const size_t channel) const;
+
+    bool hasIQBalance(const int direction, const size_t channel) const;
+
+    void setIQBalance(const int direction, const size_t channel, const std::complex<double> &balance);
+
+    std::complex<double> getIQBalance(const int direction, const size_t channel) const;
+
     bool hasFrequencyCorrection(const int direction, const size_t channel) const;
 
     void setFrequencyCorrection(const int direction, const size_t channel, const double value);
@@ -212,6 +267,8 @@ public:
 
     void setHardwareTime(const long long timeNs, const std::string &what = "");
 
+    void setCommandTime(const long long timeNs, const std::string &what = "");
+
  /*******************************************************************
      * Clocking API
      ******************************************************************/
@@ -254,6 +311,10 @@ public:
 
     std::string readSetting(const std::string &key) const;
 
+    SoapySDR::ArgInfoList getSettingInfo(const int direction, const size_t channel) const;
+
+    std::string readSetting(const int direction, const size_t channel, const std::string &key) const;
+
 private:
 
     //device handle
@@ -265,45 +326,365 @@ private:
 
     std::string time_source;
 
+    //the external clock sources follow a reference shared in the process,
+    //device time is the shared time plus the offset in nanoseconds,
+    //and a pending pps latch moves the offset on its edge
+    mutable std::mutex _time_mutex;
+    std::string _timebase_name;
+    std::shared_ptr<SharedTimebase> _timebase;
+    std::atomic<long long> _timebase_offset;
+    bool _pps_pending;
+    long long _pps_edge, _pps_time;
+
+    long long timebaseOffset(const long long timeNs) const;
+    void latchPps(void);
+    void waitRealTime(const size_t numElems, std::chrono::steady_clock::time_point &nextTime);
+
     //int tunerType;
-    uint32_t sampleRate, centerFrequency, bandwidth;
-    int ppm, directSamplingMode;
-    size_t numBuffers, bufferLength, asyncBuffs;
-    bool iqSwap, gainMode, offsetMode, digitalAGC, biasTee;
-    double IFGain[6], tunerGain;
+    //the settings the producer and the readers use are written by the
+    //API threads, so they are atomic
+    std::atomic<uint32_t> sampleRate, centerFrequency[2], bandwidth;
+    std::atomic<double> ppm;
+    int directSamplingMode;
+    size_t asyncBuffs;
+    std::atomic<bool> iqSwap, gainMode, offsetMode, digitalAGC, biasTee;
+    std::atomic<double> IFGain[6], tunerGain;
     std::atomic<long long> ticks;
 
-    std::vector<std::complex<float> > _lut_32f;
-    std::vector<std::complex<float> > _lut_swap_32f;
-    std::vector<std::complex<int16_t> > _lut_16i;
-    std::vector<std::complex<int16_t> > _lut_swap_16i;
+    //stream formats, converted from the ring in readStream and into the
+    //delay line in writeStream; each engine is made of the conversion
+    //loops instantiated for its format, and a stream picks one in
+    //setupStream. The ring, the producer, the MTU and direct buffer
+    //access stay on CS8, the word of the emulated 8 bit ADC and the native
+    //format, so wider formats carry 8 bits of resolution at their own full scale
+    struct StreamEngine
+    {
+        const char *format;
+        size_t bytesPerSample;
+        float fullScale;
+        bool ringFormat; //the ring holds samples in this format
+
+        void (*correct)(const signed char *in, void *out, const size_t numElems,
+            const float *m, const float *b, LevelSums &sums);
+        void (*unpack)(const void *in, std::complex<float> *out, const size_t numElems);
+        void (*check)(PrbsChecker &checker, const void *in, const size_t numElems);
+    };
+
+    static const StreamEngine *findEngine(const std::string &format);
+
+    const StreamEngine *_tx_engine;
+
+    //front end corrections, applied in the same pass as the conversion,
+    //the complex ones under a lock that the conversion takes a copy with
+    std::atomic<bool> dcOffsetMode;
+    mutable std::mutex _correction_mutex;
+    std::complex<double> dcOffset, iqBalance;
+
+    //timed command queue, drained by the producer thread
+    enum CommandType
+    {
+        CMD_FREQUENCY,
+        CMD_GAIN,
+        CMD_SAMPLE_RATE,
+    };
+
+    struct Command
+    {
+        long long timeNs; //device time it is due, which a rate change keeps
+        CommandType type;
+        int direction;
+        size_t channel;
+        std::string name;
+        double value;
+    };
+
+    std::mutex _cmd_mutex;
+    std::deque<Command> _cmds;
+    long long commandTime;
+
+    bool queueCommand(const CommandType type, const int direction, const size_t channel,
+            const std::string &name, const double value, const SoapySDR::Kwargs &args = SoapySDR::Kwargs());
+    size_t runCommands(const long long tick, const size_t numElems, const bool boundary);
+    void applyCommand(const Command &cmd);
+    void applyFrequency(const int direction, const size_t channel, const std::string &name, const double frequency);
+    void applyGain(const int direction, const size_t channel, const std::string &name, const double value);
+    void applySampleRate(const double rate);
+
+    //channel impairments applied by the producer, see Impairments.cpp
+    enum FadingModel
+    {
+        FADING_NONE,
+        FADING_RAYLEIGH,
+        FADING_RICIAN,
+    };
+
+    bool impairments;
+    double snr, ricianK, doppler, iqGain, iqPhase;
+    FadingModel fading;
+    double _imp_phase, _imp_time, _imp_rot_dphi;
+    std::vector<float> _imp_noise, _imp_rot_re, _imp_rot_im;
+    std::vector<double> _imp_fade_freqs, _imp_fade_phases;
+    uint32_t _imp_rng;
+    std::vector<std::complex<float> > _rx_work;
+
+    //sample clock drift, resampling from the transmitter clock
+    double ppmWalk, _drift_walk;
+    FarrowResampler _rx_resampler;
+    std::vector<std::complex<float> > _rx_src;
+
+    //channel filter, designed on bandwidth and rate changes
+    size_t oversample;
+    std::mutex _filter_mutex;
+    std::map<std::pair<double, double>, std::vector<float> > _filter_cache;
+    std::vector<float> _filter_taps;
+    size_t _filter_decim;
+    std::atomic<bool> _filter_changed;
+    std::atomic<bool> _rate_changed; //the chain starts over on a new rate
+    bool _filter_active;
+    FirDecimator _rx_decimator;
+
+    void designChannelFilter(void);
+    double channelBandwidth(void) const;
+
+    //wideband mode, every channelizer output is an RX channel
+    size_t channelizer;
+    PolyphaseChannelizer _rx_channelizer;
+    std::vector<std::vector<std::complex<float> > > _rx_chan_work;
+    std::vector<std::complex<float> *> _rx_chan_outs;
+    std::vector<std::complex<float> > _rx_agc_work;
+
+    //digital AGC ahead of quantization, one per RX channel
+    double agcReference, agcAttack, agcDecay;
+    std::vector<BlockAgc> _rx_agc;
+
+    void applyAgc(const size_t channel, std::complex<float> *buff, const size_t numElems);
+
+    //transmit path into the receiver, a fixed delay plus multipath taps
+    size_t loopbackDelay;
+    std::string multipath;
+    std::mutex _air_mutex;
+    std::condition_variable _air_cond;
+    MultipathDelayLine _air;
+    long long _tx_cursor;
+    bool _air_restart;
+    std::atomic<bool> _tx_active;
+
+    //first tick of a timed transmit start
+    long long _tx_start_tick;
+
+    //transmit status events, pushed by the producer for readStreamStatus
+    struct StreamStatus
+    {
+        int code;
+        int flags;
+        long long tick;
+    };
+
+    BoundedQueue<StreamStatus> _tx_status;
+    BoundedQueue<long long> _tx_burst_ends;
+    long long _tx_burst_next;
+    bool _tx_burst_pending, _tx_in_burst, _tx_late;
+    std::mutex _status_mutex;
+    std::condition_variable _status_cond;
+
+    void pushStatus(const int code, const int flags, const long long tick);
+    bool isTxStream(SoapySDR::Stream *stream) const;
+
+    //socket bridge to a device in another process: the transmitted
+    //samples go out as tick stamped frames as well, and the frames
+    //coming in are written into the air a fixed latency ahead
+    std::unique_ptr<SocketBridge> _bridge_tx, _bridge_rx;
+    size_t bridgeLatency;
+    long long _bridge_offset;
+    bool _bridge_anchored;
+    std::thread _bridge_thread;
+    std::atomic<bool> _bridge_running;
+    void bridge_rx_operation(void);
+
+    //capture replay: the chunks of a capture go into the air on their
+    //own ticks as if they were transmitted, the device clock starts on
+    //the first of them, and the virtual clock waits for the decompression
+    std::unique_ptr<CaptureReplay> _replay;
+    std::atomic<long long> _replay_offset; //device tick minus capture tick
+    long long _replay_cursor;
+    bool _replay_done;
+    std::thread _replay_thread;
+    std::atomic<bool> _replay_running;
+    std::atomic<unsigned long long> _replay_chunks, _replay_late;
+    void replay_operation(void);
+
+    //test pattern: a bit sequence stands in for the transmitter and
+    //every reader checks it in the samples it reads
+    std::atomic<int> prbsOrder;
+    PrbsGenerator _prbs_gen;
+    std::vector<std::complex<float> > _prbs_symbols;
+    std::complex<float> _prbs_symbol;
+    size_t _prbs_held; //samples the last symbol still runs on for
+    size_t _prbs_phase; //of the symbols to the output of the filter
+    void holdPrbs(std::complex<float> *out, const size_t numElems, const size_t hold);
+
+    //virtual time: samples are made as fast as the streams take them
+    bool virtualTime;
+
+    bool waitVirtualTime(const size_t numElems);
+    void notifyVirtualTime(void);
+    void receiveAir(std::complex<float> *out, const size_t numElems, const long long tick);
+
+    void initImpairments(void);
+    float gaussian(void);
+    double driftStep(const size_t numElems, const double rate);
+    void impairSamples(std::complex<float> *buff, const size_t numElems, const double rate);
+    std::complex<float> fadingAt(const double t) const;
 
 
 public:
     struct Buffer
     {
         unsigned long long tick;
-        std::vector<signed char> data;
+        std::vector<std::vector<signed char> > data; //one per stream channel
+        size_t refs; //readers that have not released it yet
+        bool zero; //all samples are zero and the data was never written
+        unsigned long long seq; //slots the ring opened before this one
+        unsigned long long first; //samples the ring made before this one
+
+        //level sums of each channel, made as the producer writes the slot
+        //for direct access readers; metered when they cover all of it
+        std::vector<LevelSums> levels;
+        bool metered;
+    };
+
+    struct RxStream;
+
+    //One receive ring with its own lock, so that streams on different
+    //channels never wait on each other. The device producer is the sample
+    //clock for all of them: it renders a span into the slot at the tail of
+    //every active ring and steps to the nearest end of a slot, so each ring
+    //gets whole buffers in place. A slot is handed to every reader of the
+    //ring and is written again once all of them released it; one still held
+    //when the tail comes around is parked with its holders and the slot
+    //takes spare storage, so one slow reader loses nothing for the others.
+    struct RxRing
+    {
+        RxRing(void);
+
+        std::vector<size_t> channels;
+        std::vector<RxStream *> readers; //changed with the producer stopped
+
+        std::mutex mutex;
+        std::vector<Buffer> buffs;
+        std::atomic<size_t> numBuffers, bufferLength;
+        size_t tail;
+
+        //the slot at the tail while the producer renders it
+        size_t fill, slotElems;
+        std::vector<signed char *> outs;
+
+        //read only zeros that stand in for the data of zero buffers
+        std::vector<signed char> zeros;
+
+        //adaptive ring: more buffers on an overflow near miss, fewer after
+        //a window of low occupancy, and buffers as long as the reads
+        bool adaptive, adaptiveLen, grow;
+        size_t ringMin, ringMax, minLen, maxLen;
+        size_t peak, window;
+
+        //handles given out to direct access users stay valid only while
+        //the slots stay put, so such a ring keeps its size and length
+        std::atomic<bool> direct;
+
+        //push mode hands each rendered buffer to the callback in place
+        bool push;
+        RxCallback callback;
+        void *user;
+
+        //loop mode renders the slots once and only stamps their ticks
+        bool loop;
+
+        //numbering of the slots and their samples, lost ones included
+        unsigned long long seq, produced;
+
+        //slots parked until their holders release them, under the lock,
+        //and the storage of released ones kept for the next to park
+        std::list<Buffer> parked;
+        std::vector<std::vector<std::vector<signed char> > > spares;
+    };
+
+    //One reader of a ring, the stream handle: its own cursor, counters and
+    //format, so a slow reader overflows alone and drops only its own backlog
+    struct RxStream
+    {
+        RxStream(void);
+
+        std::shared_ptr<RxRing> ring;
+        const StreamEngine *engine;
+        std::atomic<bool> active;
+        std::atomic<long long> startTick; //first tick of a timed start
+
+        //buffers handed to this reader and not acquired yet,
+        //from the head on, under the ring lock
+        std::atomic<size_t> head;
+        std::atomic<size_t> count;
+        std::condition_variable cond;
+        ReadyEvent ready;
+        std::atomic<bool> stalled; //virtual time is held up elsewhere
+        std::atomic<bool> overflow;
+        std::atomic<bool> reset;
+
+        //handles acquired and not released yet, under the ring lock,
+        //and those of them whose slot was parked with its buffer
+        std::vector<size_t> held;
+        std::vector<std::pair<size_t, Buffer *> > parked;
+
+        std::vector<signed char *> currentBuffs;
+        size_t currentHandle;
+        size_t bufferedElems;
+        long long bufTicks;
+        bool bufZero; //the buffer acquired last is a zero buffer
+        std::vector<std::complex<double> > dcEstimate; //one per stream channel
+        std::atomic<size_t> readSize;
+
+        //the buffers acquired are checked against the numbering of the
+        //ring: missing ones are gaps, and the samples they held are lost
+        bool seqValid;
+        unsigned long long nextSeq, nextFirst;
+        std::atomic<unsigned long long> gaps, lost;
+
+        //the test pattern in the output of each stream channel
+        std::vector<PrbsChecker> prbs;
+
+        //signal level of each stream channel, from the conversion pass,
+        //and the sums the producer made of the buffer acquired last
+        std::vector<LevelMeter> levels;
+        std::vector<LevelSums> bufLevels;
     };
 
     //async api usage
     std::thread _rx_async_thread;
+    std::atomic<bool> _rx_async_running;
     void rx_async_operation(void);
-    void rx_callback(unsigned char *buf, uint32_t len);
-
-    std::mutex _buf_mutex;
-    std::condition_variable _buf_cond;
-
-    std::vector<Buffer> _buffs;
-    size_t	_buf_head;
-    size_t	_buf_tail;
-    std::atomic<size_t>	_buf_count;
-    signed char *_currentBuff;
-    std::atomic<bool> _overflowEvent;
-    size_t _currentHandle;
-    size_t bufferedElems;
-    long long bufTicks;
-    std::atomic<bool> resetBuffer;
+    size_t claimSlot(RxRing &ring, const long long tick);
+    void openSlot(RxRing &ring, const long long tick);
+    void parkSlot(RxRing &ring);
+    void commitSlot(RxRing &ring);
+    void drainReader(RxStream &stream);
+    void releaseSlot(RxStream &stream, const size_t handle);
+    int acquireSlot(RxStream &stream, size_t &handle, const void **buffs, int &flags, long long &timeNs, const long timeoutUs);
+    bool ringFull(RxRing &ring);
+    void renderSamples(const long long tick, const size_t offset, const size_t numElems);
+    void convertSamples(RxStream &stream, const size_t index, const signed char *in, void *out, const size_t numElems);
+    void checkPrbs(RxStream &stream, const StreamEngine &engine, const void * const *buffs, const size_t numElems, const bool resync);
+    void updateProducer(void);
+    void stopProducer(void);
+
+    //the lists of rings, streams and readers change with the producer
+    //stopped and under this lock, which settings and sensors take
+    mutable std::mutex _rx_mutex;
+    std::vector<std::shared_ptr<RxRing> > _rx_rings;
+    std::vector<std::unique_ptr<RxStream> > _rx_streams;
+    RxRing *findRxRing(const size_t channel) const;
+
+    void adaptRing(RxRing &ring);
+    bool resizeRing(RxRing &ring, const size_t size);
 
     double gainMin, gainMax;
 };
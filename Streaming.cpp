@@ -27,9 +27,11 @@
 #include <SoapySDR/Logger.hpp>
 #include <SoapySDR/Formats.hpp>
 #include <SoapySDR/Time.hpp>
-#include <algorithm> //min
+#include <algorithm> //min, find
 #include <climits> //SHRT_MAX
 #include <cstring> // memcpy
+#include <chrono>
+#include <limits>
 
 
 std::vector<std::string> SoapyLoopback::getStreamFormats(const int direction, const size_t channel) const {
@@ -45,7 +47,9 @@ std::vector<std::string> SoapyLoopback::getStreamFormats(const int direction, co
 
 std::string SoapyLoopback::getNativeStreamFormat(const int direction, const size_t channel, double &fullScale) const {
 
-     return SOAPY_SDR_CS12;
+     //the format of the ring, as direct buffer access and push hand it out
+     fullScale = findEngine(SOAPY_SDR_CS8)->fullScale;
+     return SOAPY_SDR_CS8;
 }
 
 SoapySDR::ArgInfoList SoapyLoopback::getStreamArgsInfo(const int direction, const size_t channel) const {
@@ -88,246 +92,1756 @@ SoapySDR::ArgInfoList SoapyLoopback::getStreamArgsInfo(const int direction, cons
  * Async thread work
  ******************************************************************/
 
+SoapyLoopback::RxRing::RxRing(void):
+    numBuffers(DEFAULT_NUM_BUFFERS),
+    bufferLength(DEFAULT_BUFFER_LENGTH),
+    tail(0),
+    fill(0),
+    slotElems(0),
+    adaptive(false),
+    adaptiveLen(false),
+    grow(false),
+    ringMin(2),
+    ringMax(4*DEFAULT_NUM_BUFFERS),
+    minLen(1024),
+    maxLen(4*DEFAULT_BUFFER_LENGTH),
+    peak(0),
+    window(0),
+    direct(false),
+    push(false),
+    callback(nullptr),
+    user(nullptr),
+    loop(false),
+    seq(0),
+    produced(0)
+{
+    return;
+}
+
+SoapyLoopback::RxStream::RxStream(void):
+    engine(findEngine(SOAPY_SDR_CS8)),
+    active(false),
+    startTick(std::numeric_limits<long long>::min()),
+    head(0),
+    count(0),
+    stalled(false),
+    overflow(false),
+    reset(false),
+    currentHandle(0),
+    bufferedElems(0),
+    bufTicks(0),
+    bufZero(false),
+    readSize(0),
+    seqValid(false),
+    nextSeq(0),
+    nextFirst(0),
+    gaps(0),
+    lost(0)
+{
+    return;
+}
+
 void SoapyLoopback::rx_async_operation(void)
 {
-    //printf("rx_async_operation\n");
-    //rtlsdr_read_async(dev, &_rx_callback, this, asyncBuffs, bufferLength);
-    //printf("rx_async_operation done!\n");
+    auto nextTime = std::chrono::steady_clock::now();
+
+    //a device that follows the reference picks up the shared clock,
+    //which kept running while the producer was stopped
+    {
+        std::lock_guard<std::mutex> lock(_time_mutex);
+        if (_timebase and not virtualTime)
+        {
+            const long long now = _timebase->nowNs();
+            ticks = SoapySDR::timeNsToTicks(now + this->timebaseOffset(now), sampleRate);
+        }
+    }
+
+    for (auto &ring : _rx_rings) ring->fill = ring->slotElems = 0;
+
+    while (_rx_async_running)
+    {
+        if (not virtualTime) this->latchPps();
+
+        //the clock steps to the nearest end of a slot, or of the span
+        //before a timed start, with only the transmitter a whole buffer
+        size_t step = 0;
+        for (auto &ring : _rx_rings)
+        {
+            const size_t n = this->claimSlot(*ring, ticks);
+            if (n != 0) step = (step == 0) ? n : std::min(step, n);
+        }
+        if (step == 0) step = DEFAULT_BUFFER_LENGTH / BYTES_PER_SAMPLE;
+
+        //pace the producer to the configured sample rate,
+        //or in virtual time to whoever drives the clock
+        if (virtualTime)
+        {
+            if (not this->waitVirtualTime(step)) break;
+        }
+        else this->waitRealTime(step, nextTime);
+
+        //commands that are due by now, including rate changes,
+        //take effect on the buffer boundary
+        this->runCommands(ticks, 0, true);
+        const long long tick = ticks;
+
+        //slots start once the wait is over, when the readers had
+        //their chance to make room
+        bool render = false;
+        for (auto &ring : _rx_rings)
+        {
+            if (ring->slotElems == 0) continue;
+            if (ring->fill == 0) this->openSlot(*ring, tick);
+            render = render or not ring->loop;
+        }
+
+        //nothing to render: commands in this span still apply and the
+        //transmitted samples in it are consumed, which is all that happens
+        //when only the transmitter and loop rings are active
+        if (not render)
+        {
+            for (size_t offset = 0; offset < step;)
+            {
+                offset += this->runCommands(tick + offset, step - offset, false);
+            }
+            this->receiveAir(nullptr, step, tick);
+        }
+
+        //render straight into the slots of the rings,
+        //splitting the span wherever a timed command lands
+        else for (size_t offset = 0; offset < step;)
+        {
+            const size_t n = this->runCommands(tick + offset, step - offset, false);
+            this->renderSamples(tick + offset, offset, n);
+            offset += n;
+        }
+        ticks += step;
+
+        //hand over the slots that are complete
+        for (auto &ring : _rx_rings)
+        {
+            if (ring->slotElems == 0) continue;
+            ring->fill += step;
+            if (ring->fill == ring->slotElems) this->commitSlot(*ring);
+        }
+    }
+}
+
+size_t SoapyLoopback::claimSlot(RxRing &ring, const long long tick)
+{
+    //the ring runs while any of its readers does,
+    //from the earliest timed start among them
+    bool active = false;
+    long long start = std::numeric_limits<long long>::max();
+    for (auto *reader : ring.readers)
+    {
+        if (not reader->active) continue;
+        active = true;
+        start = std::min<long long>(start, reader->startTick);
+    }
+
+    //a ring that was stopped starts on a new slot
+    if (not active)
+    {
+        ring.fill = ring.slotElems = 0;
+        return 0;
+    }
+    if (ring.slotElems != 0) return ring.slotElems - ring.fill;
+
+    //an adaptive ring changes size between buffers
+    if ((ring.adaptive or ring.adaptiveLen) and not ring.push and not ring.direct) this->adaptRing(ring);
+    const size_t numElems = ring.bufferLength / BYTES_PER_SAMPLE;
+
+    //the span before a timed receive start is cut short
+    //so that the first buffer of the stream begins on the tick
+    if (tick < start) return size_t(std::min<long long>(numElems, start - tick));
+
+    ring.fill = 0;
+    ring.slotElems = numElems;
+    return numElems;
+}
+
+void SoapyLoopback::drainReader(RxStream &stream)
+{
+    //give back every buffer the reader did not acquire yet
+    auto &ring = *stream.ring;
+    for (size_t i = 0; i < stream.count; i++)
+    {
+        ring.buffs[(stream.head + i) % ring.numBuffers].refs--;
+    }
+    stream.head = (stream.head + stream.count.exchange(0)) % ring.numBuffers;
+}
+
+void SoapyLoopback::releaseSlot(RxStream &stream, const size_t handle)
+{
+    //under the ring lock
+    auto &ring = *stream.ring;
+
+    //a parked slot is released first, its storage becomes
+    //a spare once the last of its holders released it
+    for (auto held = stream.parked.begin(); held != stream.parked.end(); ++held)
+    {
+        if (held->first != handle) continue;
+        Buffer *buff = held->second;
+        stream.parked.erase(held);
+        if (--buff->refs != 0) return;
+        ring.spares.push_back(std::move(buff->data));
+        for (auto it = ring.parked.begin(); it != ring.parked.end(); ++it)
+        {
+            if (&*it != buff) continue;
+            ring.parked.erase(it);
+            break;
+        }
+        return;
+    }
+
+    const auto it = std::find(stream.held.begin(), stream.held.end(), handle);
+    if (it != stream.held.end()) stream.held.erase(it);
+    ring.buffs[handle].refs--;
+}
+
+bool SoapyLoopback::ringFull(RxRing &ring)
+{
+    std::lock_guard<std::mutex> lock(ring.mutex);
+    return ring.buffs[ring.tail].refs != 0;
+}
+
+void SoapyLoopback::openSlot(RxRing &ring, const long long tick)
+{
+    std::lock_guard<std::mutex> lock(ring.mutex);
+    auto &buff = ring.buffs[ring.tail];
+
+    //every slot takes its number, so the readers see the ones lost
+    const unsigned long long seq = ring.seq++;
+    const unsigned long long first = ring.produced;
+    ring.produced += ring.slotElems;
+
+    //overflow condition: a reader is not reading fast enough, its
+    //backlog goes around the ring to this slot and it is dropped,
+    //while the other readers keep theirs
+    if (buff.refs != 0)
+    {
+        for (auto *reader : ring.readers)
+        {
+            if (reader->count == 0 or reader->head != ring.tail) continue;
+            this->drainReader(*reader);
+            reader->overflow = true;
+        }
+        ring.grow = true;
+    }
+
+    //a slot a reader still holds is parked, the tail goes on
+    if (buff.refs != 0) this->parkSlot(ring);
+
+    buff.tick = tick;
+    buff.seq = seq;
+    buff.first = first;
+    for (auto &data : buff.data)
+    {
+        //give back the memory of a buffer length that shrank
+        data.resize(ring.slotElems*BYTES_PER_SAMPLE);
+        if (data.capacity() > 2*data.size()) data.shrink_to_fit();
+    }
+
+    //the slot stays a zero buffer until something other than silence
+    //is rendered into it, loop rings keep what they were rendered with;
+    //it is measured when direct access readers could get it
+    buff.zero = not ring.loop;
+    if (not ring.loop)
+    {
+        buff.metered = ring.direct;
+        buff.levels.assign(buff.metered ? buff.data.size() : 0, LevelSums());
+    }
+}
+
+void SoapyLoopback::parkSlot(RxRing &ring)
+{
+    //under the ring lock: the held buffer moves to the parked list
+    //as it is, so the pointers its holders have stay valid
+    auto &buff = ring.buffs[ring.tail];
+    ring.parked.emplace_back(buff);
+    auto &parked = ring.parked.back();
+    parked.data.clear();
+    parked.data.swap(buff.data);
+
+    //the holders release it from there, each of their holds of the slot
+    for (auto *reader : ring.readers)
+    {
+        for (auto it = reader->held.begin(); it != reader->held.end();)
+        {
+            if (*it != ring.tail) ++it;
+            else
+            {
+                reader->parked.emplace_back(ring.tail, &parked);
+                it = reader->held.erase(it);
+            }
+        }
+    }
+
+    //and the slot goes on with spare storage, sized when it opens;
+    //a loop ring keeps its waveform
+    if (ring.spares.empty()) buff.data.resize(parked.data.size());
+    else
+    {
+        buff.data.swap(ring.spares.back());
+        ring.spares.pop_back();
+    }
+    if (ring.loop) for (size_t i = 0; i < buff.data.size(); i++) buff.data[i] = parked.data[i];
+    buff.refs = 0;
+}
+
+void SoapyLoopback::commitSlot(RxRing &ring)
+{
+    const size_t numElems = ring.slotElems;
+    ring.fill = ring.slotElems = 0;
+
+    //a push stream gets the buffer in place and it is reused
+    //as soon as the callback returns
+    auto &buff = ring.buffs[ring.tail];
+    if (ring.push)
+    {
+        for (size_t i = 0; i < buff.data.size(); i++) ring.outs[i] = buff.zero ? ring.zeros.data() : buff.data[i].data();
+        ring.callback(ring.user, (const void * const *)ring.outs.data(), numElems,
+            SoapySDR::ticksToTimeNs(buff.tick, sampleRate), SOAPY_SDR_HAS_TIME);
+        return;
+    }
+
+    //hand the buffer to every reader that started by its time,
+    //under lock to avoid a race in the acquireReadBuffer wait,
+    //and signal an event loop when the reader had nothing;
+    //the others follow the tail with nothing to read
+    {
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        const size_t next = (ring.tail + 1) % ring.numBuffers;
+        for (auto *reader : ring.readers)
+        {
+            if (not reader->active or (long long)buff.tick < reader->startTick)
+            {
+                this->drainReader(*reader);
+                reader->head = next;
+                continue;
+            }
+            buff.refs++;
+            if (reader->count++ == 0) reader->ready.signal();
+        }
+
+        //increment the tail pointer
+        ring.tail = next;
+    }
+
+    //notify readStream()
+    for (auto *reader : ring.readers) reader->cond.notify_one();
+}
+
+//quantize to the ring format, rounding to nearest
+static inline signed char quantizeSample(const float x)
+{
+    const float v = x*127.0f + (x < 0.0f ? -0.5f : 0.5f);
+    return (signed char)std::max(-127.0f, std::min(127.0f, v));
+}
+
+static void quantizeSamples(const std::complex<float> *in, signed char *out, const size_t numElems)
+{
+    const float *x = reinterpret_cast<const float *>(in);
+    for (size_t i = 0; i < numElems*2; i++) out[i] = quantizeSample(x[i]);
+}
+
+//direct access readers get the ring itself, so its samples are
+//measured for them as they are written and not read again later
+static void quantizeSamples(const std::complex<float> *in, signed char *out, const size_t numElems, LevelSums &sums)
+{
+    const float *x = reinterpret_cast<const float *>(in);
+    LevelAccumulator<int8_t> levels(127.0);
+    for (size_t k = 0; k < numElems; k += LEVEL_LANES)
+    {
+        const size_t n = std::min<size_t>(LEVEL_LANES, numElems - k);
+        for (size_t l = 0; l < n; l++)
+        {
+            const signed char yi = quantizeSample(x[2*(k+l)+0]);
+            const signed char yq = quantizeSample(x[2*(k+l)+1]);
+            out[2*(k+l)+0] = yi;
+            out[2*(k+l)+1] = yq;
+            levels.add(l, yi, yq, yi, yq);
+        }
+        levels.next();
+    }
+    LevelSums span;
+    levels.store(span);
+    sums += span;
+}
+
+//true when every sample quantizes to zero, stopping at the first that does not
+static bool isSilent(const std::complex<float> *in, const size_t numElems)
+{
+    const float *x = reinterpret_cast<const float *>(in);
+    for (size_t i = 0; i < numElems*2; i++)
+    {
+        if (std::abs(x[i])*127.0f >= 0.5f) return false;
+    }
+    return true;
+}
+
+//seconds of low occupancy after which the ring shrinks
+#define RING_WINDOW_SECONDS 2.0
+
+void SoapyLoopback::adaptRing(RxRing &ring)
+{
+    //one read takes one buffer, shorter buffers when the readers ask
+    //for little and less overhead per call when one asks for a lot
+    size_t readSize = 0;
+    for (auto *reader : ring.readers) readSize = std::max<size_t>(readSize, reader->readSize*BYTES_PER_SAMPLE);
+    if (ring.adaptiveLen and readSize != 0)
+    {
+        size_t length = ring.minLen;
+        while (length < readSize and length < ring.maxLen) length *= 2;
+        length = std::min(length, ring.maxLen);
+        if (length != ring.bufferLength)
+        {
+            SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback buffer length %d", int(length));
+            ring.bufferLength = length;
+        }
+    }
+    if (not ring.adaptive) return;
+
+    //a ring three quarters full is a near miss of an overflow, it
+    //grows right after that or an overflow, as soon as the slots allow;
+    //one that stayed under a quarter for the window shrinks
+    const size_t size = ring.numBuffers;
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        for (const auto &buff : ring.buffs) if (buff.refs != 0) count++;
+    }
+    if (count*4 >= size*3) ring.grow = true;
+    ring.peak = std::max(ring.peak, count);
+    ring.window += ring.bufferLength/BYTES_PER_SAMPLE;
+
+    size_t target = size;
+    const bool windowDone = (ring.window >= RING_WINDOW_SECONDS*sampleRate);
+    if (ring.grow) target = std::min(size*2, ring.ringMax);
+    else if (windowDone and ring.peak*4 <= size) target = std::max(size/2, ring.ringMin);
+
+    //when the slots do not allow it yet the next buffer tries again
+    if (target != size)
+    {
+        if (not this->resizeRing(ring, target)) return;
+        SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback ring of %d buffers", int(target));
+    }
+
+    //a new window starts after a change or after a busy window
+    if (target != size or windowDone)
+    {
+        ring.window = 0;
+        ring.peak = 0;
+    }
+    ring.grow = false;
+}
+
+bool SoapyLoopback::resizeRing(RxRing &ring, const size_t size)
+{
+    std::lock_guard<std::mutex> lock(ring.mutex);
+
+    //slots change at the tail while no reader holds one from there to
+    //the end, otherwise a later buffer tries again; then every reader
+    //has its buffers before the tail and their handles stay put
+    const size_t tail = ring.tail;
+    const size_t current = ring.numBuffers;
+    for (size_t i = tail; i < current; i++)
+    {
+        if (ring.buffs[i].refs != 0) return false;
+    }
+
+    if (size > current)
+    {
+        Buffer buff;
+        buff.tick = 0;
+        buff.data.resize(ring.channels.size());
+        buff.refs = 0;
+        buff.zero = false;
+        buff.seq = buff.first = 0;
+        buff.metered = false;
+        ring.buffs.insert(ring.buffs.begin() + tail, size - current, buff);
+    }
+    else
+    {
+        if (current - size >= current - tail) return false;
+        ring.buffs.erase(ring.buffs.begin() + tail, ring.buffs.begin() + tail + (current - size));
+    }
+    ring.numBuffers = size;
+    return true;
+}
+
+void SoapyLoopback::latchPps(void)
+{
+    //a pps latch takes effect on the first buffer after its edge,
+    //placing that buffer where the latched time puts it
+    std::lock_guard<std::mutex> lock(_time_mutex);
+    if (not _pps_pending) return;
+    const long long startNs = SoapySDR::ticksToTimeNs(ticks, sampleRate) - _timebase_offset;
+    if (startNs < _pps_edge) return;
+    _timebase_offset = _pps_time - _pps_edge;
+    _pps_pending = false;
+    ticks = SoapySDR::timeNsToTicks(startNs + _timebase_offset, sampleRate);
+}
+
+void SoapyLoopback::waitRealTime(const size_t numElems, std::chrono::steady_clock::time_point &nextTime)
+{
+    std::unique_lock<std::mutex> lock(_time_mutex);
+    if (not _timebase)
+    {
+        lock.unlock();
+        nextTime += std::chrono::nanoseconds(SoapySDR::ticksToTimeNs(numElems, sampleRate));
+        std::this_thread::sleep_until(nextTime);
+        return;
+    }
+
+    //each buffer is released when the shared clock reaches its end,
+    //so the same tick comes out at the same time on every device
+    const auto timebase = _timebase;
+    const long long endNs = SoapySDR::ticksToTimeNs(ticks + (long long)numElems, sampleRate) - _timebase_offset;
+    lock.unlock();
+    nextTime = timebase->timeAt(endNs);
+    std::this_thread::sleep_until(nextTime);
+}
+
+bool SoapyLoopback::waitVirtualTime(const size_t numElems)
+{
+    std::unique_lock<std::mutex> lock(_air_mutex);
+
+    //an active transmitter holds the clock at the last sample it wrote,
+    //gaps before timed bursts included, so does a capture replay until
+    //its last chunk, and a receiver holds it while
+    //its ring is full; only what was written is ever received
+    //(the margin covers what the drift resampler reads ahead)
+    const long long txNeeded = numElems + numElems/64 + 8;
+    auto ready = [this, txNeeded]
+    {
+        if (not _rx_async_running) return true;
+        if (_tx_active and not _air_restart and _tx_cursor < _air.readTick() + txNeeded) return false;
+        if (_replay and not _replay_done and not _air_restart and _replay_cursor < _air.readTick() + txNeeded) return false;
+        bool rx = false;
+        for (auto &stream : _rx_streams) rx = rx or stream->active;
+        for (auto &ring : _rx_rings)
+        {
+            if (ring->slotElems != 0 and ring->fill == 0 and this->ringFull(*ring)) return false;
+        }
+        return rx or _tx_active;
+    };
+    if (ready()) return _rx_async_running;
+
+    //a reader with nothing to read is told that time is held up
+    for (auto &stream : _rx_streams)
+    {
+        if (not stream->active or stream->count == stream->ring->numBuffers) continue;
+        {
+        std::lock_guard<std::mutex> bufLock(stream->ring->mutex);
+        stream->stalled = true;
+        }
+        stream->cond.notify_one();
+    }
+    _air_cond.wait(lock, ready);
+    for (auto &stream : _rx_streams) stream->stalled = false;
+    return _rx_async_running;
+}
+
+void SoapyLoopback::receiveAir(std::complex<float> *out, const size_t numElems, const long long tick)
+{
+    if (not _tx_active and not _bridge_rx and not _replay) return;
+
+    {
+        std::lock_guard<std::mutex> lock(_air_mutex);
+
+        //the transmit timeline is placed on the receiver tick that reads
+        //it first, so that tick t on transmit arrives on t + delay,
+        //untimed writes go out from the current tick and the bridge
+        //places its frames again from there
+        if (_air_restart)
+        {
+            _air.reset(DEFAULT_AIR_LENGTH, tick - (long long)loopbackDelay);
+            _tx_cursor = std::max(tick, _tx_start_tick);
+            _air_restart = false;
+            _bridge_anchored = false;
+        }
+        _air.read(out, numElems);
+
+        //bursts whose last sample went out are acknowledged
+        while (_tx_burst_pending or _tx_burst_ends.pop(_tx_burst_next))
+        {
+            _tx_burst_pending = true;
+            if (_tx_burst_next > _air.readTick()) break;
+            this->pushStatus(0, SOAPY_SDR_END_BURST | SOAPY_SDR_HAS_TIME, _tx_burst_next);
+            _tx_burst_pending = false;
+        }
+
+        //the transmitter ran dry in the middle of a burst
+        if (_tx_in_burst and _tx_cursor < _air.readTick())
+        {
+            _tx_in_burst = false;
+            this->pushStatus(SOAPY_SDR_UNDERFLOW, SOAPY_SDR_HAS_TIME, _tx_cursor);
+        }
+    }
+
+    //there is room for the transmitter again
+    _air_cond.notify_all();
+}
+
+void SoapyLoopback::bridge_rx_operation(void)
+{
+    while (_bridge_running)
+    {
+        const size_t numFrames = _bridge_rx->receive();
+        if (numFrames == 0) continue;
+
+        std::lock_guard<std::mutex> lock(_air_mutex);
+        for (size_t j = 0; j < numFrames; j++)
+        {
+            const auto &hdr = _bridge_rx->header(j);
+            const auto *samples = _bridge_rx->samples(j);
+
+            //nothing is received until the producer places the air
+            if (_air_restart or not _rx_async_running)
+            {
+                _bridge_rx->drop();
+                continue;
+            }
+
+            //the sender timeline goes the latency ahead of the read position,
+            //and is placed again when the clocks of the two processes drift
+            //so far apart that a frame falls outside the delay line
+            long long tick = hdr.tick + _bridge_offset;
+            const long long end = tick + hdr.numElems;
+            if (not _bridge_anchored or end <= _air.readTick() or end > _air.writeLimit())
+            {
+                if (_bridge_anchored) SoapySDR_logf(SOAPY_SDR_DEBUG,
+                    "Loopback bridge frame at tick %lld realigned", (long long)hdr.tick);
+                _bridge_offset = _air.readTick() + (long long)bridgeLatency - hdr.tick;
+                _bridge_anchored = true;
+                tick = hdr.tick + _bridge_offset;
+            }
+
+            //a frame that is partly late keeps the part still ahead of the reader
+            const size_t skip = size_t(std::max<long long>(_air.readTick() - tick, 0));
+            const size_t total = hdr.numElems - skip;
+            for (size_t offset = 0; offset < total;)
+            {
+                size_t n = total - offset;
+                std::complex<float> *out = _air.writeSpan(tick + skip + offset, n);
+                std::memcpy(out, samples + skip + offset, n*sizeof(std::complex<float>));
+                offset += n;
+            }
+        }
+    }
+}
+
+void SoapyLoopback::renderSamples(const long long tick, const size_t offset, const size_t numElems)
+{
+    //pick up a new channel filter design
+    if (_filter_changed.exchange(false))
+    {
+        std::lock_guard<std::mutex> lock(_filter_mutex);
+        _filter_active = not _filter_taps.empty();
+        if (_filter_active) _rx_decimator.configure(_filter_taps, _filter_decim);
+
+        //a held test symbol is centered on the sample the decimator
+        //keeps, which is its last input less the delay of the filter
+        const long long delay = _filter_active ? (_filter_taps.size() - 1)/2 : 0;
+        const long long hold = _filter_active ? _filter_decim : 1;
+        _prbs_phase = size_t(((hold - 1 - delay - (hold - 1)/2) % hold + hold) % hold);
+        _prbs_held = _prbs_phase;
+    }
+
+    //history from the old rate would smear into the new one,
+    //the filter history went with its new design above
+    if (_rate_changed.exchange(false))
+    {
+        _rx_resampler.reset();
+        if (channelizer != 0) _rx_channelizer.configure(channelizer);
+        for (auto &rxAgc : _rx_agc) rxAgc.reset();
+    }
+
+    //the agc runs in either gain mode and holds unity gain otherwise
+    const bool agc = gainMode or digitalAGC;
+    if (not agc) for (auto &rxAgc : _rx_agc) rxAgc.reset();
+
+    //the test pattern restarts when its order changes
+    const int prbs = prbsOrder;
+    if (prbs != _prbs_gen.order())
+    {
+        _prbs_gen.configure(prbs);
+        _prbs_held = _prbs_phase;
+        _rx_resampler.reset();
+    }
+
+    //nothing is transmitted into the loopback, the receiver hears silence
+    const bool tx = _tx_active or _bridge_rx or _replay;
+    if (not tx and prbs == 0 and not impairments and not _filter_active and channelizer == 0 and not agc)
+    {
+        for (auto &ring : _rx_rings)
+        {
+            if (ring->slotElems == 0 or ring->loop) continue;
+            auto &buff = ring->buffs[ring->tail];
+            if (buff.zero) continue;
+            for (auto &data : buff.data)
+            {
+                std::memset(data.data() + (ring->fill + offset)*BYTES_PER_SAMPLE, 0, numElems*BYTES_PER_SAMPLE);
+            }
+        }
+        return;
+    }
+
+    //the channel runs at the internal rate ahead of the filter,
+    //or at the wideband rate ahead of the channelizer
+    size_t decim = 1;
+    if (channelizer != 0) decim = channelizer;
+    else if (_filter_active) decim = _filter_decim;
+    const size_t numChannel = numElems*decim;
+    const double rate = double(sampleRate)*decim;
+
+    //what the transmitter sent, interpolated to the internal rate
+    //and resampled for the drift of the receiver sample clock
+    double step = 1.0;
+    if (impairments and (ppm != 0.0 or ppmWalk != 0.0)) step = this->driftStep(numChannel, rate);
+    if (not tx and prbs == 0)
+    {
+        _rx_resampler.reset();
+        _rx_work.assign(numChannel, std::complex<float>(0.0f));
+    }
+
+    //the test pattern is sent in place of the transmitter and the air is
+    //dropped; it has one symbol per output sample held over the internal
+    //rate, so the filter sees whole symbols and not an interpolation
+    else if (prbs != 0)
+    {
+        this->receiveAir(nullptr, numElems, tick);
+        _rx_work.resize(numChannel);
+        if (step == 1.0)
+        {
+            _rx_resampler.reset();
+            this->holdPrbs(_rx_work.data(), numChannel, decim);
+        }
+        else
+        {
+            _rx_src.resize(_rx_resampler.inputsNeeded(numChannel, step));
+            this->holdPrbs(_rx_src.data(), _rx_src.size(), decim);
+            _rx_resampler.process(_rx_src.data(), _rx_work.data(), numChannel, step);
+        }
+    }
+    else if (step == 1.0 and decim == 1)
+    {
+        _rx_resampler.reset();
+        _rx_work.resize(numChannel);
+        this->receiveAir(_rx_work.data(), numChannel, tick);
+    }
+    else
+    {
+        step /= decim;
+        _rx_src.resize(_rx_resampler.inputsNeeded(numChannel, step));
+        this->receiveAir(_rx_src.data(), _rx_src.size(), tick);
+        _rx_work.resize(numChannel);
+        _rx_resampler.process(_rx_src.data(), _rx_work.data(), numChannel, step);
+    }
+
+    if (impairments) this->impairSamples(_rx_work.data(), numChannel, rate);
+
+    //split the wideband signal into every channel,
+    //or filter the one channel, decimating to the output rate in place
+    if (channelizer != 0)
+    {
+        for (size_t k = 0; k < channelizer; k++)
+        {
+            _rx_chan_work[k].resize(numElems);
+            _rx_chan_outs[k] = _rx_chan_work[k].data();
+        }
+        _rx_channelizer.process(_rx_work.data(), _rx_chan_outs.data(), numElems);
+    }
+    else if (_filter_active) _rx_decimator.process(_rx_work.data(), _rx_work.data(), numElems);
+
+    //each ring keeps its channels, channels without a channelizer
+    //are receivers on the same antenna and hear the same signal
+    for (auto &ring : _rx_rings)
+    {
+        if (ring->slotElems == 0 or ring->loop) continue;
+        auto &buff = ring->buffs[ring->tail];
+        for (size_t i = 0; i < ring->channels.size(); i++)
+        {
+            const size_t channel = ring->channels[i];
+            auto *chan = (channelizer != 0) ? _rx_chan_work[channel].data() : _rx_work.data();
+            if (agc and channelizer == 0)
+            {
+                _rx_agc_work.assign(chan, chan + numElems);
+                chan = _rx_agc_work.data();
+            }
+            if (agc) this->applyAgc(channel, chan, numElems);
+
+            //silence leaves a zero buffer alone, anything else writes
+            //out the zeros it stood for before it is quantized
+            if (buff.zero)
+            {
+                if (isSilent(chan, numElems)) continue;
+                for (auto &data : buff.data) std::memset(data.data(), 0, (ring->fill + offset + numElems)*BYTES_PER_SAMPLE);
+                buff.zero = false;
+            }
+            auto *out = buff.data[i].data() + (ring->fill + offset)*BYTES_PER_SAMPLE;
+            if (buff.metered) quantizeSamples(chan, out, numElems, buff.levels[i]);
+            else quantizeSamples(chan, out, numElems);
+        }
+    }
+}
+
+void SoapyLoopback::holdPrbs(std::complex<float> *out, const size_t numElems, const size_t hold)
+{
+    //the symbol of the last call runs on first, then each new one
+    //fills hold samples and the last may run on into the next call
+    size_t i = std::min(numElems, _prbs_held);
+    std::fill(out, out + i, _prbs_symbol);
+    _prbs_held -= i;
+    _prbs_symbols.resize((numElems - i + hold - 1)/hold);
+    _prbs_gen.generate(_prbs_symbols.data(), _prbs_symbols.size());
+    for (const auto &symbol : _prbs_symbols)
+    {
+        const size_t n = std::min(hold, numElems - i);
+        std::fill(out + i, out + i + n, symbol);
+        _prbs_symbol = symbol;
+        _prbs_held = hold - n;
+        i += n;
+    }
+}
+
+void SoapyLoopback::applyAgc(const size_t channel, std::complex<float> *buff, const size_t numElems)
+{
+    auto &rxAgc = _rx_agc[channel];
+    rxAgc.configure(agcReference, agcAttack, agcDecay, sampleRate);
+    rxAgc.process(buff, numElems);
+}
+
+/*******************************************************************
+ * Stream API
+ ******************************************************************/
+
+SoapySDR::Stream *SoapyLoopback::setupStream(
+        const int direction,
+        const std::string &format,
+        const std::vector<size_t> &channels,
+        const SoapySDR::Kwargs &args)
+{
+
+    //check the format, the stream keeps the engine for it
+    const StreamEngine *engine = findEngine(format);
+    if (engine == nullptr)
+    {
+        throw std::runtime_error(
+                "setupStream invalid format '" + format
+                        + "' -- Only CS8, CS12, CS16 and CF32 are supported by SoapyLoopback module.");
+    }
+    SoapySDR_logf(SOAPY_SDR_INFO, "Using format %s.", engine->format);
+
+    //the transmitter writes channel 0 into the delay line
+    if (direction == SOAPY_SDR_TX)
+    {
+        if (channels.size() > 1 or (channels.size() > 0 and channels.at(0) != 0))
+        {
+            throw std::runtime_error("setupStream invalid channel selection");
+        }
+        _tx_engine = engine;
+        return (SoapySDR::Stream *) &_air;
+    }
+    std::unique_ptr<RxStream> rx(new RxStream());
+    rx->engine = engine;
+    const auto rxChannels = channels.empty() ? std::vector<size_t>(1, 0) : channels;
+
+    //attach=true adds a reader to the ring that carries these channels,
+    //it shares the buffers with the other readers without a copy
+    if (args.count("attach") != 0 and args.at("attach") == "true")
+    {
+        auto *shared = this->findRxRing(rxChannels.front());
+        if (shared == nullptr or shared->channels != rxChannels or shared->push)
+        {
+            throw std::runtime_error("setupStream attach needs an open stream of the same channels");
+        }
+        for (auto &ring : _rx_rings) if (ring.get() == shared) rx->ring = ring;
+        rx->currentBuffs.resize(rxChannels.size());
+        rx->dcEstimate.assign(rxChannels.size(), 0.0);
+        rx->prbs = std::vector<PrbsChecker>(rxChannels.size());
+        rx->levels = std::vector<LevelMeter>(rxChannels.size());
+
+        auto *stream = rx.get();
+        this->stopProducer();
+        {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        shared->readers.push_back(stream);
+        _rx_streams.push_back(std::move(rx));
+        }
+        this->updateProducer();
+        return (SoapySDR::Stream *) stream;
+    }
+
+    rx->ring = std::make_shared<RxRing>();
+    auto &ring = *rx->ring;
+
+    //push streams hand out the ring buffers in place
+    ring.push = (args.count("push") != 0 and args.at("push") == "true");
+    if (ring.push and not engine->ringFormat)
+    {
+        throw std::runtime_error("setupStream push streams deliver the CS8 ring format");
+    }
+
+    //check the channel configuration, a channel is in one ring at a time
+    ring.channels = rxChannels;
+    for (const auto channel : ring.channels)
+    {
+        if (channel >= this->getNumChannels(SOAPY_SDR_RX))
+        {
+            throw std::runtime_error("setupStream invalid channel selection");
+        }
+        if (std::count(ring.channels.begin(), ring.channels.end(), channel) != 1 or this->findRxRing(channel) != nullptr)
+        {
+            throw std::runtime_error("setupStream channel " + std::to_string(channel) + " is already streaming");
+        }
+    }
+
+    if (args.count("bufflen") != 0)
+    {
+        try
+        {
+            int bufferLength_in = std::stoi(args.at("bufflen"));
+            if (bufferLength_in > 0)
+            {
+                ring.bufferLength = bufferLength_in;
+            }
+        }
+        catch (const std::invalid_argument &){}
+    }
+    SoapySDR_logf(SOAPY_SDR_DEBUG, "RTL-SDR Using buffer length %d", int(ring.bufferLength));
+
+    if (args.count("buffers") != 0)
+    {
+        try
+        {
+            int numBuffers_in = std::stoi(args.at("buffers"));
+            if (numBuffers_in > 0)
+            {
+                ring.numBuffers = numBuffers_in;
+            }
+        }
+        catch (const std::invalid_argument &){}
+    }
+    SoapySDR_logf(SOAPY_SDR_DEBUG, "RTL-SDR Using %d buffers", int(ring.numBuffers));
+
+    asyncBuffs = 0;
+    if (args.count("asyncBuffs") != 0)
+    {
+        try
+        {
+            int asyncBuffs_in = std::stoi(args.at("asyncBuffs"));
+            if (asyncBuffs_in > 0)
+            {
+                asyncBuffs = asyncBuffs_in;
+            }
+        }
+        catch (const std::invalid_argument &){}
+    }
+    //if (tunerType == RTLSDR_TUNER_E4000) {
+    //    IFGain[0] = 6;
+    //    IFGain[1] = 9;
+    //    IFGain[2] = 3;
+    //    IFGain[3] = 2;
+    //    IFGain[4] = 3;
+    //    IFGain[5] = 3;
+    //} else {
+    //    for (int i = 0; i < 6; i++) {
+    //        IFGain[i] = 0;
+    //    }
+    //}
+    //tunerGain = rtlsdr_get_tuner_gain(dev) / 10.0;
+
+    //the adaptive ring starts from the buffers and bufflen args
+    //and stays within its bounds until direct buffer access fixes it
+    ring.adaptive = (args.count("adaptive") != 0 and args.at("adaptive") == "true");
+    ring.adaptiveLen = (args.count("adaptive_bufflen") != 0 and args.at("adaptive_bufflen") == "true");
+    try
+    {
+        if (args.count("min_buffers") != 0) ring.ringMin = std::max(std::stoi(args.at("min_buffers")), 2);
+        if (args.count("max_buffers") != 0) ring.ringMax = std::max<size_t>(std::stoi(args.at("max_buffers")), ring.ringMin);
+        if (args.count("min_bufflen") != 0) ring.minLen = std::max(std::stoi(args.at("min_bufflen")), BYTES_PER_SAMPLE);
+        if (args.count("max_bufflen") != 0) ring.maxLen = std::max<size_t>(std::stoi(args.at("max_bufflen")), ring.minLen);
+    }
+    catch (const std::invalid_argument &)
+    {
+        throw std::runtime_error("setupStream invalid adaptive ring bounds");
+    }
+    if (ring.adaptive) ring.numBuffers = std::max(ring.ringMin, std::min<size_t>(ring.numBuffers, ring.ringMax));
+    if (ring.adaptiveLen) ring.bufferLength = std::max(ring.minLen, std::min<size_t>(ring.bufferLength, ring.maxLen));
+
+    //allocate buffers, room for the adaptive ring is reserved so that
+    //the reader never sees the slots move while it grows
+    ring.buffs.reserve(ring.adaptive ? ring.ringMax : size_t(ring.numBuffers));
+    ring.buffs.resize(ring.numBuffers);
+    for (auto &buff : ring.buffs)
+    {
+        buff.data.resize(ring.channels.size());
+        for (auto &data : buff.data) data.resize(ring.bufferLength);
+        buff.refs = 0;
+        buff.zero = false;
+        buff.seq = buff.first = 0;
+        buff.metered = false;
+    }
+    ring.zeros.assign(ring.adaptiveLen ? ring.maxLen : size_t(ring.bufferLength), 0);
+    //loop=N renders a tone of N cycles per buffer into every slot once,
+    //so the waveform runs on across buffers and the producer only
+    //stamps the slots with their ticks from then on
+    if (args.count("loop") != 0)
+    {
+        int cycles = 0;
+        try
+        {
+            cycles = std::stoi(args.at("loop"));
+        }
+        catch (const std::exception &)
+        {
+            throw std::runtime_error("setupStream loop is the number of tone cycles per buffer");
+        }
+        if (ring.adaptive or ring.adaptiveLen)
+        {
+            throw std::runtime_error("setupStream loop rings keep the buffers they were rendered into");
+        }
+        const size_t numElems = ring.bufferLength / BYTES_PER_SAMPLE;
+        std::vector<std::complex<float> > tone(numElems);
+        for (size_t k = 0; k < numElems; k++)
+        {
+            tone[k] = std::polar(0.5f, float(2*M_PI*((long long)cycles*(long long)k % (long long)numElems)/numElems));
+        }
+        for (auto &buff : ring.buffs)
+        {
+            buff.levels.assign(buff.data.size(), LevelSums());
+            for (size_t i = 0; i < buff.data.size(); i++) quantizeSamples(tone.data(), buff.data[i].data(), numElems, buff.levels[i]);
+            buff.metered = true;
+        }
+        ring.loop = true;
+    }
+
+    ring.outs.resize(ring.channels.size());
+    rx->currentBuffs.resize(ring.channels.size());
+    rx->dcEstimate.assign(ring.channels.size(), 0.0);
+    rx->prbs = std::vector<PrbsChecker>(ring.channels.size());
+    rx->levels = std::vector<LevelMeter>(ring.channels.size());
+
+    //the producer may be running for the other streams,
+    //hold it while the list of streams changes
+    auto *stream = rx.get();
+    this->stopProducer();
+    {
+    std::lock_guard<std::mutex> lock(_rx_mutex);
+    ring.readers.push_back(stream);
+    _rx_rings.push_back(rx->ring);
+    _rx_streams.push_back(std::move(rx));
+    }
+    _rx_chan_work.resize(channelizer);
+    _rx_chan_outs.resize(channelizer);
+    this->updateProducer();
+
+    return (SoapySDR::Stream *) stream;
+}
+
+SoapyLoopback::RxRing *SoapyLoopback::findRxRing(const size_t channel) const
+{
+    for (auto &ring : _rx_rings)
+    {
+        const auto &chans = ring->channels;
+        if (std::find(chans.begin(), chans.end(), channel) != chans.end()) return ring.get();
+    }
+    return nullptr;
+}
+
+void SoapyLoopback::closeStream(SoapySDR::Stream *stream)
+{
+    this->deactivateStream(stream, 0, 0);
+    if (this->isTxStream(stream)) return;
+
+    //the reader gives back its buffers and leaves the ring,
+    //which goes away with the last one
+    auto &rx = *reinterpret_cast<RxStream *>(stream);
+    if (rx.bufferedElems != 0) this->releaseReadBuffer(stream, rx.currentHandle);
+    this->stopProducer();
+    auto &readers = rx.ring->readers;
+    {
+        std::lock_guard<std::mutex> lock(rx.ring->mutex);
+        this->drainReader(rx);
+        while (not rx.parked.empty()) this->releaseSlot(rx, rx.parked.front().first);
+        while (not rx.held.empty()) this->releaseSlot(rx, rx.held.front());
+    }
+    {
+    std::lock_guard<std::mutex> lock(_rx_mutex);
+    readers.erase(std::find(readers.begin(), readers.end(), &rx));
+    if (readers.empty()) _rx_rings.erase(std::find(_rx_rings.begin(), _rx_rings.end(), rx.ring));
+    for (auto it = _rx_streams.begin(); it != _rx_streams.end(); ++it)
+    {
+        if (it->get() != &rx) continue;
+        _rx_streams.erase(it);
+        break;
+    }
+    }
+    this->updateProducer();
+}
+
+size_t SoapyLoopback::getStreamMTU(SoapySDR::Stream *stream) const
+{
+    if (this->isTxStream(stream)) return DEFAULT_BUFFER_LENGTH / BYTES_PER_SAMPLE;
+    return reinterpret_cast<RxStream *>(stream)->ring->bufferLength / BYTES_PER_SAMPLE;
+}
+
+bool SoapyLoopback::isTxStream(SoapySDR::Stream *stream) const
+{
+    return stream == (SoapySDR::Stream *) &_air;
+}
+
+void SoapyLoopback::updateProducer(void)
+{
+    //the producer runs while any stream is active,
+    //it is the sample clock of the transmitter as well
+    bool active = _tx_active;
+    for (auto &stream : _rx_streams) active = active or stream->active;
+    if (active and not _rx_async_thread.joinable())
+    {
+        //bridge frames are placed again on the restarted clock
+        if (_bridge_rx)
+        {
+            std::lock_guard<std::mutex> lock(_air_mutex);
+            _air_restart = true;
+        }
+
+        //a replay starts the clock on the first tick of the capture,
+        //so that receive timestamps are capture ticks
+        if (_replay and _replay_chunks == 0)
+        {
+            std::lock_guard<std::mutex> lock(_air_mutex);
+            ticks = _replay->firstTick();
+            _air.reset(DEFAULT_AIR_LENGTH, ticks - (long long)loopbackDelay);
+            _tx_cursor = ticks;
+            _replay_cursor = _air.readTick();
+            _air_restart = false;
+        }
+        _rx_async_running = true;
+        _rx_async_thread = std::thread(&SoapyLoopback::rx_async_operation, this);
+    }
+    if (not active) this->stopProducer();
+
+    //wake a producer in virtual time, who drives the clock changed
+    else this->notifyVirtualTime();
+}
+
+void SoapyLoopback::notifyVirtualTime(void)
+{
+    if (not virtualTime) return;
+    {
+    std::lock_guard<std::mutex> lock(_air_mutex);
+    }
+    _air_cond.notify_all();
+}
+
+void SoapyLoopback::stopProducer(void)
+{
+    _rx_async_running = false;
+    this->notifyVirtualTime();
+    for (auto &stream : _rx_streams)
+    {
+        {
+        std::lock_guard<std::mutex> lock(stream->ring->mutex);
+        }
+        stream->cond.notify_all();
+    }
+    if (_rx_async_thread.joinable())
+    {
+        _rx_async_thread.join();
+    }
 }
 
-void SoapyLoopback::rx_callback(unsigned char *buf, uint32_t len)
+int SoapyLoopback::activateStream(
+        SoapySDR::Stream *stream,
+        const int flags,
+        const long long timeNs,
+        const size_t numElems)
 {
-    //printf("_rx_callback %d _buf_head=%d, numBuffers=%d\n", len, _buf_head, _buf_tail);
+    if ((flags & ~SOAPY_SDR_HAS_TIME) != 0) return SOAPY_SDR_NOT_SUPPORTED;
 
-    // atomically add len to ticks but return the previous value
-    unsigned long long tick = ticks.fetch_add(len);
+    //a timed start begins the stream on that tick, so devices on a
+    //shared timebase given the same time start together
+    const long long startTick = ((flags & SOAPY_SDR_HAS_TIME) != 0) ?
+        SoapySDR::timeNsToTicks(timeNs, sampleRate) : std::numeric_limits<long long>::min();
 
-    //overflow condition: the caller is not reading fast enough
-    if (_buf_count == numBuffers)
+    if (this->isTxStream(stream))
     {
-        _overflowEvent = true;
-        return;
+        //the producer places the transmit timeline on its next buffer,
+        //in virtual time it waits for the transmitter, so place it now;
+        //untimed writes continue from the start time
+        std::lock_guard<std::mutex> lock(_air_mutex);
+        _air_restart = true;
+        _tx_start_tick = startTick;
+        if (virtualTime)
+        {
+            _air.reset(DEFAULT_AIR_LENGTH, ticks - (long long)loopbackDelay);
+            _tx_cursor = std::max<long long>(ticks, _tx_start_tick);
+            _air_restart = false;
+        }
+        _tx_in_burst = false;
+        _tx_late = false;
+        _tx_active = true;
     }
-
-    //copy into the buffer queue
-    auto &buff = _buffs[_buf_tail];
-    buff.tick = tick;
-    buff.data.resize(len);
-    std::memcpy(buff.data.data(), buf, len);
-
-    //increment the tail pointer
-    _buf_tail = (_buf_tail + 1) % numBuffers;
-
-    //increment buffers available under lock
-    //to avoid race in acquireReadBuffer wait
+    else
     {
-    std::lock_guard<std::mutex> lock(_buf_mutex);
-    _buf_count++;
+        auto &rx = *reinterpret_cast<RxStream *>(stream);
+        if (rx.ring->push and rx.ring->callback == nullptr)
+        {
+            SoapySDR_log(SOAPY_SDR_ERROR, "Loopback push stream activated without a callback");
+            return SOAPY_SDR_STREAM_ERROR;
+        }
 
+        //the reader starts from the next buffer of the ring, or the
+        //first one on a timed start, and drops what it did not read
+        std::lock_guard<std::mutex> lock(rx.ring->mutex);
+        if (rx.bufferedElems != 0) this->releaseSlot(rx, rx.currentHandle);
+        this->drainReader(rx);
+        rx.head = rx.ring->tail;
+        rx.seqValid = false;
+        rx.startTick = startTick;
+        rx.reset = false;
+        rx.overflow = false;
+        rx.bufferedElems = 0;
+        rx.active = true;
     }
 
-    //notify readStream()
-    _buf_cond.notify_one();
+    //start the async thread
+    this->updateProducer();
+
+    return 0;
 }
 
-/*******************************************************************
- * Stream API
- ******************************************************************/
+int SoapyLoopback::deactivateStream(SoapySDR::Stream *stream, const int flags, const long long timeNs)
+{
+    if (flags != 0) return SOAPY_SDR_NOT_SUPPORTED;
+    if (this->isTxStream(stream))
+    {
+        _tx_active = false;
+        //the rest of the burst goes out within the default stream timeout
+        if (_bridge_tx) _bridge_tx->flush(true, 100000);
+    }
+    else reinterpret_cast<RxStream *>(stream)->active = false;
+    this->updateProducer();
+    return 0;
+}
 
-SoapySDR::Stream *SoapyLoopback::setupStream(
-        const int direction,
-        const std::string &format,
-        const std::vector<size_t> &channels,
-        const SoapySDR::Kwargs &args)
+int SoapyLoopback::readStream(
+        SoapySDR::Stream *stream,
+        void * const *buffs,
+        const size_t numElems,
+        int &flags,
+        long long &timeNs,
+        const long timeoutUs)
 {
+    if (this->isTxStream(stream)) return SOAPY_SDR_NOT_SUPPORTED;
+    auto &rx = *reinterpret_cast<RxStream *>(stream);
 
-    //check the channel configuration
-    if (channels.size() > 1 or (channels.size() > 0 and channels.at(0) != 0))
+    //drop remainder buffer on reset
+    if (rx.reset and rx.bufferedElems != 0)
     {
-        throw std::runtime_error("setupStream invalid channel selection");
+        rx.bufferedElems = 0;
+        this->releaseReadBuffer(stream, rx.currentHandle);
     }
 
-    //check the format
-    if (format == SOAPY_SDR_CF32)
+    //the adaptive buffer length follows the size of the reads
+    rx.readSize = numElems;
+
+    //are elements left in the buffer? if not, do a new read.
+    const long long lastTick = rx.bufTicks;
+    if (rx.bufferedElems == 0)
     {
-        SoapySDR_log(SOAPY_SDR_INFO, "Using format CF32.");
-        //rxFormat = RTL_RX_FORMAT_FLOAT32;
+        int ret = this->acquireSlot(rx, rx.currentHandle, (const void **)rx.currentBuffs.data(), flags, timeNs, timeoutUs);
+        if (ret < 0) return ret;
+        rx.bufferedElems = ret;
     }
-    else if (format == SOAPY_SDR_CS12)
+
+    //otherwise just update return time to the current tick count
+    else
     {
-        SoapySDR_log(SOAPY_SDR_INFO, "Using format CS12.");
-        //rxFormat = RTL_RX_FORMAT_INT16;
+        flags |= SOAPY_SDR_HAS_TIME;
+        timeNs = SoapySDR::ticksToTimeNs(rx.bufTicks, sampleRate);
     }
-    else if (format == SOAPY_SDR_CS16)
+
+    size_t returnedElems = std::min(rx.bufferedElems, numElems);
+
+    //convert out of the ring for every channel,
+    //the held buffer does not change while it is read
+    const bool zero = rx.bufZero;
+    for (size_t i = 0; i < rx.currentBuffs.size(); i++)
     {
-        SoapySDR_log(SOAPY_SDR_INFO, "Using format CS16.");
-        //rxFormat = RTL_RX_FORMAT_INT16;
-    }
-    else if (format == SOAPY_SDR_CS8) {
-        SoapySDR_log(SOAPY_SDR_INFO, "Using format CS8.");
-        //rxFormat = RTL_RX_FORMAT_INT8;
+        this->convertSamples(rx, i, zero ? nullptr : rx.currentBuffs[i], buffs[i], returnedElems);
+        rx.currentBuffs[i] += returnedElems*BYTES_PER_SAMPLE;
     }
-    else
+
+    //check the test pattern in what the caller gets
+    this->checkPrbs(rx, *rx.engine, buffs, returnedElems, rx.bufTicks != lastTick);
+
+    //bump variables for next call into readStream
+    rx.bufferedElems -= returnedElems;
+    rx.bufTicks += returnedElems; //for the next call to readStream if there is a remainder
+
+    //return number of elements written to each buffer
+    if (rx.bufferedElems != 0) flags |= SOAPY_SDR_MORE_FRAGMENTS;
+    else this->releaseReadBuffer(stream, rx.currentHandle);
+    return returnedElems;
+}
+
+void SoapyLoopback::checkPrbs(RxStream &stream, const StreamEngine &engine, const void * const *buffs, const size_t numElems, const bool resync)
+{
+    //the checkers look for the pattern again after a break in the ticks
+    const int prbs = prbsOrder;
+    for (size_t i = 0; i < stream.prbs.size(); i++)
     {
-        throw std::runtime_error(
-                "setupStream invalid format '" + format
-                        + "' -- Only CS8, CS16 and CF32 are supported by SoapyLoopback module.");
+        auto &checker = stream.prbs[i];
+        if (checker.order() != prbs) checker.configure(prbs);
+        if (prbs == 0) continue;
+        if (resync) checker.resync();
+        engine.check(checker, buffs[i], numElems);
     }
+}
 
-    bufferLength = DEFAULT_BUFFER_LENGTH;
-    if (args.count("bufflen") != 0)
+/*******************************************************************
+ * Format conversion
+ ******************************************************************/
+
+//samples in the time constant of the automatic DC offset tracking
+#define DC_TRACKING_SAMPLES 65536
+
+//full scale of each interleaved sample word
+template <typename T> static inline float fullScale(void);
+template <> inline float fullScale<int8_t>(void) {return 127.0f;}
+template <> inline float fullScale<int16_t>(void) {return 32767.0f;}
+template <> inline float fullScale<float>(void) {return 1.0f;}
+
+//round and saturate to the integer formats, floats pass through
+template <typename T>
+static inline T toSample(const float v)
+{
+    const float max = fullScale<T>();
+    const float r = std::max(-max, std::min(max, v));
+    return T(r + (r < 0.0f ? -0.5f : 0.5f));
+}
+
+template <>
+inline float toSample<float>(const float v)
+{
+    return v;
+}
+
+//Correct and convert in one pass: out = m*in + b, where the 2x2 matrix
+//folds IQ balance, IQ swap and scaling and b removes the DC offset.
+//The samples are summed on the way for DC offset tracking and levels,
+//a group of samples at a time so that the loop vectorizes.
+template <typename T>
+static void correctSamples(const signed char *in, void *out, const size_t numElems,
+    const float *m, const float *b, LevelSums &sums)
+{
+    T *y = reinterpret_cast<T *>(out);
+    LevelAccumulator<T> levels(fullScale<T>());
+    for (size_t k = 0; k < numElems; k += LEVEL_LANES)
     {
-        try
+        const size_t n = std::min<size_t>(LEVEL_LANES, numElems - k);
+        for (size_t l = 0; l < n; l++)
         {
-            int bufferLength_in = std::stoi(args.at("bufflen"));
-            if (bufferLength_in > 0)
-            {
-                bufferLength = bufferLength_in;
-            }
+            const int xi = in[2*(k+l)+0];
+            const int xq = in[2*(k+l)+1];
+            const T yi = toSample<T>(m[0]*xi + m[1]*xq + b[0]);
+            const T yq = toSample<T>(m[2]*xi + m[3]*xq + b[1]);
+            y[2*(k+l)+0] = yi;
+            y[2*(k+l)+1] = yq;
+            levels.add(l, xi, xq, yi, yq);
         }
-        catch (const std::invalid_argument &){}
+        levels.next();
     }
-    SoapySDR_logf(SOAPY_SDR_DEBUG, "RTL-SDR Using buffer length %d", bufferLength);
+    levels.store(sums);
+}
 
-    numBuffers = DEFAULT_NUM_BUFFERS;
-    if (args.count("buffers") != 0)
+//the ring format needs no conversion, it is copied in the same pass
+static void copySamples(const signed char *in, void *out, const size_t numElems, LevelSums &sums)
+{
+    signed char *y = reinterpret_cast<signed char *>(out);
+    LevelAccumulator<int8_t> levels(fullScale<int8_t>());
+    for (size_t k = 0; k < numElems; k += LEVEL_LANES)
     {
-        try
+        const size_t n = std::min<size_t>(LEVEL_LANES, numElems - k);
+        for (size_t l = 0; l < n; l++)
         {
-            int numBuffers_in = std::stoi(args.at("buffers"));
-            if (numBuffers_in > 0)
-            {
-                numBuffers = numBuffers_in;
-            }
+            const signed char xi = in[2*(k+l)+0];
+            const signed char xq = in[2*(k+l)+1];
+            y[2*(k+l)+0] = xi;
+            y[2*(k+l)+1] = xq;
+            levels.add(l, xi, xq, xi, xq);
         }
-        catch (const std::invalid_argument &){}
+        levels.next();
     }
-    SoapySDR_logf(SOAPY_SDR_DEBUG, "RTL-SDR Using %d buffers", numBuffers);
+    levels.store(sums);
+}
 
-    asyncBuffs = 0;
-    if (args.count("asyncBuffs") != 0)
+//CS12 packs each 12 bit pair into three bytes, a group of samples
+//is converted and measured first and then packed on its own, as the
+//loop of three byte stores does not vectorize
+static void correctSamples12(const signed char *in, void *out, const size_t numElems,
+    const float *m, const float *b, LevelSums &sums)
+{
+    //the bytes written could alias the correction, so it is read once
+    uint8_t *y = reinterpret_cast<uint8_t *>(out);
+    const float m0 = m[0], m1 = m[1], m2 = m[2], m3 = m[3], b0 = b[0], b1 = b[1];
+    LevelAccumulator<int16_t> levels(2047.0);
+    int16_t si[LEVEL_LANES], sq[LEVEL_LANES];
+    for (size_t k = 0; k < numElems; k += LEVEL_LANES)
     {
-        try
+        const size_t n = std::min<size_t>(LEVEL_LANES, numElems - k);
+        for (size_t l = 0; l < n; l++)
         {
-            int asyncBuffs_in = std::stoi(args.at("asyncBuffs"));
-            if (asyncBuffs_in > 0)
-            {
-                asyncBuffs = asyncBuffs_in;
-            }
+            const int xi = in[2*(k+l)+0];
+            const int xq = in[2*(k+l)+1];
+            si[l] = toSample<int16_t>(std::max(-2047.0f, std::min(2047.0f, m0*xi + m1*xq + b0)));
+            sq[l] = toSample<int16_t>(std::max(-2047.0f, std::min(2047.0f, m2*xi + m3*xq + b1)));
+            levels.add(l, xi, xq, si[l], sq[l]);
+        }
+        levels.next();
+        for (size_t l = 0; l < n; l++)
+        {
+            const uint16_t i = uint16_t(si[l]);
+            const uint16_t q = uint16_t(sq[l]);
+            y[3*(k+l)+0] = uint8_t(i);
+            y[3*(k+l)+1] = uint8_t(((i >> 8) & 0x0f) | (q << 4));
+            y[3*(k+l)+2] = uint8_t(q >> 4);
         }
-        catch (const std::invalid_argument &){}
     }
-    //if (tunerType == RTLSDR_TUNER_E4000) {
-    //    IFGain[0] = 6;
-    //    IFGain[1] = 9;
-    //    IFGain[2] = 3;
-    //    IFGain[3] = 2;
-    //    IFGain[4] = 3;
-    //    IFGain[5] = 3;
-    //} else {
-    //    for (int i = 0; i < 6; i++) {
-    //        IFGain[i] = 0;
-    //    }
-    //}
-    //tunerGain = rtlsdr_get_tuner_gain(dev) / 10.0;
-
-    //clear async fifo counts
-    _buf_tail = 0;
-    _buf_count = 0;
-    _buf_head = 0;
+    levels.store(sums);
+}
 
-    //allocate buffers
-    _buffs.resize(numBuffers);
-    for (auto &buff : _buffs) buff.data.reserve(bufferLength);
-    for (auto &buff : _buffs) buff.data.resize(bufferLength);
+//convert from the integer formats to full scale floats
+template <typename T>
+static void unpackSamples(const void *in, std::complex<float> *out, const size_t numElems)
+{
+    const T *x = reinterpret_cast<const T *>(in);
+    const float scale = 1.0f/fullScale<T>();
+    float *y = reinterpret_cast<float *>(out);
+    for (size_t i = 0; i < 2*numElems; i++) y[i] = x[i]*scale;
+}
 
-    return (SoapySDR::Stream *) this;
+template <>
+void unpackSamples<float>(const void *in, std::complex<float> *out, const size_t numElems)
+{
+    std::memcpy(out, in, numElems*sizeof(std::complex<float>));
 }
 
-void SoapyLoopback::closeStream(SoapySDR::Stream *stream)
+//CS12 holds each 12 bit pair in three bytes
+static void unpackSamples12(const void *in, std::complex<float> *out, const size_t numElems)
 {
-    this->deactivateStream(stream, 0, 0);
-    _buffs.clear();
+    const uint8_t *x = reinterpret_cast<const uint8_t *>(in);
+    float *y = reinterpret_cast<float *>(out);
+    for (size_t k = 0; k < numElems; k++)
+    {
+        const int16_t i = int16_t(uint16_t(x[3*k+0] << 4) | uint16_t(x[3*k+1] << 12)) >> 4;
+        const int16_t q = int16_t(uint16_t(x[3*k+1] & 0xf0) | uint16_t(x[3*k+2] << 8)) >> 4;
+        y[2*k+0] = i*(1.0f/2047);
+        y[2*k+1] = q*(1.0f/2047);
+    }
 }
 
-size_t SoapyLoopback::getStreamMTU(SoapySDR::Stream *stream) const
+//the test pattern in the signs of each format
+template <typename T>
+static void checkPattern(PrbsChecker &checker, const void *in, const size_t numElems)
 {
-    return bufferLength / BYTES_PER_SAMPLE;
+    checker.check(reinterpret_cast<const T *>(in), numElems);
 }
 
-int SoapyLoopback::activateStream(
-        SoapySDR::Stream *stream,
-        const int flags,
-        const long long timeNs,
-        const size_t numElems)
+static void checkPattern12(PrbsChecker &checker, const void *in, const size_t numElems)
 {
-    if (flags != 0) return SOAPY_SDR_NOT_SUPPORTED;
-    resetBuffer = true;
-    bufferedElems = 0;
+    checker.check12(reinterpret_cast<const uint8_t *>(in), numElems);
+}
 
-    //start the async thread
-    if (not _rx_async_thread.joinable())
+//the engines of the stream formats
+const SoapyLoopback::StreamEngine *SoapyLoopback::findEngine(const std::string &format)
+{
+    static const StreamEngine engines[] = {
+        {SOAPY_SDR_CS8, 2, 127.0f, true, correctSamples<int8_t>, unpackSamples<int8_t>, checkPattern<int8_t>},
+        {SOAPY_SDR_CS12, 3, 2047.0f, false, correctSamples12, unpackSamples12, checkPattern12},
+        {SOAPY_SDR_CS16, 4, 32767.0f, false, correctSamples<int16_t>, unpackSamples<int16_t>, checkPattern<int16_t>},
+        {SOAPY_SDR_CF32, 8, 1.0f, false, correctSamples<float>, unpackSamples<float>, checkPattern<float>},
+    };
+    for (const auto &engine : engines)
     {
-        _rx_async_thread = std::thread(&SoapyLoopback::rx_async_operation, this);
+        if (format == engine.format) return &engine;
     }
-
-    return 0;
+    return nullptr;
 }
 
-int SoapyLoopback::deactivateStream(SoapySDR::Stream *stream, const int flags, const long long timeNs)
+void SoapyLoopback::convertSamples(RxStream &stream, const size_t index, const signed char *in, void *out, const size_t numElems)
 {
-    if (flags != 0) return SOAPY_SDR_NOT_SUPPORTED;
-    if (_rx_async_thread.joinable())
+    if (numElems == 0) return;
+
+    const auto &engine = *stream.engine;
+    const double scale = engine.fullScale/127.0;
+
+    //with an IQ balance of gain g and phase p the Q branch holds
+    //g*(Q*cos(p) + I*sin(p)), solve for Q after removing the DC offset
+    std::complex<double> dc, balance;
     {
-        _rx_async_thread.join();
+        std::lock_guard<std::mutex> lock(_correction_mutex);
+        dc = dcOffset;
+        balance = iqBalance;
     }
-    return 0;
+    auto &estimate = stream.dcEstimate[index];
+    if (dcOffsetMode) dc = estimate;
+    const double g = std::abs(balance);
+    const double p = std::arg(balance);
+    const double qq = 1.0/(g*std::cos(p));
+    const double qi = -std::tan(p);
+    double mi[2] = {scale, 0.0};
+    double mq[2] = {scale*qi, scale*qq};
+    double bi = -engine.fullScale*dc.real();
+    double bq = -engine.fullScale*(dc.imag()*qq + dc.real()*qi);
+    if (iqSwap)
+    {
+        std::swap(mi[0], mq[0]);
+        std::swap(mi[1], mq[1]);
+        std::swap(bi, bq);
+    }
+    const float m[4] = {float(mi[0]), float(mi[1]), float(mq[0]), float(mq[1])};
+    const float b[2] = {float(bi), float(bq)};
+    const bool offset = (b[0] != 0.0f or b[1] != 0.0f);
+
+    //a zero buffer comes in as null, and converts to zeros directly
+    //in the output format unless a DC offset is taken off them
+    const bool zero = (in == nullptr);
+    if (zero) in = stream.ring->zeros.data();
+
+    //with nothing to correct in the format of the ring the samples are copied
+    const bool copy = engine.ringFormat and not offset and
+        m[0] == 1.0f and m[1] == 0.0f and m[2] == 0.0f and m[3] == 1.0f;
+    LevelSums sums;
+    if (zero and not offset) std::memset(out, 0, numElems*engine.bytesPerSample);
+    else if (copy) copySamples(in, out, numElems, sums);
+    else engine.correct(in, out, numElems, m, b, sums);
+
+    //track the DC offset of the raw samples for the next call
+    const std::complex<double> mean(sums.rawI/(127.0*numElems), sums.rawQ/(127.0*numElems));
+    const double alpha = double(numElems)/(numElems + DC_TRACKING_SAMPLES);
+    estimate += alpha*(mean - estimate);
+    stream.levels[index].add(sums, numElems);
 }
 
-int SoapyLoopback::readStream(
+int SoapyLoopback::writeStream(
         SoapySDR::Stream *stream,
-        void * const *buffs,
+        const void * const *buffs,
         const size_t numElems,
         int &flags,
-        long long &timeNs,
+        const long long timeNs,
         const long timeoutUs)
 {
-    //drop remainder buffer on reset
-    if (resetBuffer and bufferedElems != 0)
+    if (not this->isTxStream(stream)) return SOAPY_SDR_NOT_SUPPORTED;
+
+    //timed samples go on the requested tick of the receive timeline,
+    //before the loopback delay, others continue from the last write
+    const bool timed = (flags & SOAPY_SDR_HAS_TIME) != 0;
+    const long long timedTick = timed ? SoapySDR::timeNsToTicks(timeNs, sampleRate) : 0;
+
+    std::unique_lock<std::mutex> lock(_air_mutex);
+
+    //wait for the timeline to be placed and for room in the delay line
+    auto ready = [this, timed, timedTick]
     {
-        bufferedElems = 0;
-        this->releaseReadBuffer(stream, _currentHandle);
+        return _tx_active and not _air_restart and (timed ? timedTick : _tx_cursor) < _air.writeLimit();
+    };
+    if (not _air_cond.wait_for(lock, std::chrono::microseconds(timeoutUs), ready))
+    {
+        return SOAPY_SDR_TIMEOUT;
     }
 
-    //this is the user's buffer for channel 0
-    void *buff0 = buffs[0];
+    //a burst that starts after its time on the device clock, or that
+    //the receiver already passed, is dropped up to its end
+    if (timed)
+    {
+        _tx_late = timedTick < std::max<long long>(ticks, _air.readTick());
+        if (_tx_late) this->pushStatus(SOAPY_SDR_TIME_ERROR, SOAPY_SDR_HAS_TIME, timedTick);
+        else _tx_cursor = timedTick;
+    }
+    if (_tx_late)
+    {
+        if ((flags & SOAPY_SDR_END_BURST) != 0) _tx_late = false;
+        return numElems;
+    }
 
-    //are elements left in the buffer? if not, do a new read.
-    if (bufferedElems == 0)
+    //after an underflow the samples go out from the current tick,
+    //which the receiver reads the loopback delay later
+    const long long now = _air.readTick() + (long long)loopbackDelay;
+    if (_tx_cursor < _air.readTick()) _tx_cursor = now;
+
+    //convert straight into the delay line, in at most two pieces
+    const size_t total = size_t(std::min<long long>(numElems, _air.writeLimit() - _tx_cursor));
+    for (size_t offset = 0; offset < total;)
     {
-        int ret = this->acquireReadBuffer(stream, _currentHandle, (const void **)&_currentBuff, flags, timeNs, timeoutUs);
-        if (ret < 0) return ret;
-        bufferedElems = ret;
+        size_t n = total - offset;
+        std::complex<float> *out = _air.writeSpan(_tx_cursor + offset, n);
+        _tx_engine->unpack((const char *)buffs[0] + offset*_tx_engine->bytesPerSample, out, n);
+        if (_bridge_tx) _bridge_tx->queue(_tx_cursor + offset, out, n);
+        offset += n;
     }
+    _tx_cursor += total;
 
-    //otherwise just update return time to the current tick count
-    else
+    //an unfinished burst underflows when the producer catches up,
+    //a finished one is acknowledged once its last sample is read
+    if (total != 0) _tx_in_burst = true;
+    if ((flags & SOAPY_SDR_END_BURST) != 0 and total == numElems)
     {
-        flags |= SOAPY_SDR_HAS_TIME;
-        timeNs = SoapySDR::ticksToTimeNs(bufTicks, sampleRate);
+        _tx_in_burst = false;
+        _tx_burst_ends.push(_tx_cursor);
     }
 
-    size_t returnedElems = std::min(bufferedElems, numElems);
+    //a producer in virtual time may be holding for these samples
+    lock.unlock();
+    if (virtualTime) _air_cond.notify_all();
 
-    //bump variables for next call into readStream
-    bufferedElems -= returnedElems;
-    _currentBuff += returnedElems*BYTES_PER_SAMPLE;
-    bufTicks += returnedElems; //for the next call to readStream if there is a remainder
+    //whole batches go to the bridge, the rest at the end of the burst
+    if (_bridge_tx and not _bridge_tx->flush((flags & SOAPY_SDR_END_BURST) != 0, timeoutUs))
+    {
+        SoapySDR_log(SOAPY_SDR_SSI, "B");
+    }
 
-    //return number of elements written to buff0
-    if (bufferedElems != 0) flags |= SOAPY_SDR_MORE_FRAGMENTS;
-    else this->releaseReadBuffer(stream, _currentHandle);
-    return returnedElems;
+    return total;
+}
+
+void SoapyLoopback::replay_operation(void)
+{
+    //captures hold the samples of a stream format
+    const char *format = SOAPY_SDR_CF32;
+    if (_replay->format() == REPLAY_CS8) format = SOAPY_SDR_CS8;
+    if (_replay->format() == REPLAY_CS16) format = SOAPY_SDR_CS16;
+    const StreamEngine *engine = findEngine(format);
+
+    while (_replay_running)
+    {
+        const ReplayChunk *chunk = _replay->front(100000);
+        if (chunk == nullptr)
+        {
+            if (not _replay->finished()) continue;
+
+            //the virtual clock runs on without the capture
+            {
+            std::lock_guard<std::mutex> lock(_air_mutex);
+            _replay_done = true;
+            }
+            _air_cond.notify_all();
+            return;
+        }
+
+        //wait until the whole chunk fits in the delay line
+        std::unique_lock<std::mutex> lock(_air_mutex);
+        long long tick = 0;
+        bool ready = false;
+        while (_replay_running)
+        {
+            tick = chunk->tick + _replay_offset;
+            const long long end = tick + (long long)chunk->numElems;
+
+            //the capture goes on from the read position when it fell
+            //behind, which only happens in real time when the pool
+            //did not keep up, and stays on the new timeline after
+            if (not _air_restart and chunk->numElems != 0 and end <= _air.readTick())
+            {
+                _replay_offset = _air.readTick() - chunk->tick;
+                _replay_late++;
+                SoapySDR_logf(SOAPY_SDR_DEBUG, "Loopback replay late at capture tick %lld", (long long)chunk->tick);
+                continue;
+            }
+            ready = not _air_restart and end <= _air.writeLimit();
+            if (ready) break;
+
+            //the silence up to the chunk is known, the virtual clock
+            //may run on as far as the delay line reaches
+            if (not _air_restart and _replay_cursor < std::min(tick, _air.writeLimit()))
+            {
+                _replay_cursor = std::min(tick, _air.writeLimit());
+                _air_cond.notify_all();
+            }
+            _air_cond.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        if (not ready) break;
+
+        //convert into the delay line, past what the reader already took
+        const size_t skip = size_t(std::max<long long>(_air.readTick() - tick, 0));
+        const size_t total = (chunk->numElems > skip) ? chunk->numElems - skip : 0;
+        const char *data = chunk->data.data();
+        for (size_t offset = 0; offset < total;)
+        {
+            size_t n = total - offset;
+            const size_t i = skip + offset;
+            std::complex<float> *out = _air.writeSpan(tick + i, n);
+            engine->unpack(data + i*engine->bytesPerSample, out, n);
+            offset += n;
+        }
+        _replay_cursor = std::max(_replay_cursor, tick + (long long)chunk->numElems);
+        lock.unlock();
+
+        //a producer in virtual time may be holding for this chunk
+        _air_cond.notify_all();
+        _replay->pop();
+        _replay_chunks++;
+    }
+}
+
+void SoapyLoopback::pushStatus(const int code, const int flags, const long long tick)
+{
+    _tx_status.push(StreamStatus{code, flags, tick});
+
+    //taking the lock orders the push before a reader that is about to wait
+    {
+    std::lock_guard<std::mutex> lock(_status_mutex);
+    }
+    _status_cond.notify_one();
+}
+
+int SoapyLoopback::readStreamStatus(
+        SoapySDR::Stream *stream,
+        size_t &chanMask,
+        int &flags,
+        long long &timeNs,
+        const long timeoutUs)
+{
+    if (not this->isTxStream(stream)) return SOAPY_SDR_NOT_SUPPORTED;
+
+    StreamStatus status;
+    if (not _tx_status.pop(status))
+    {
+        std::unique_lock<std::mutex> lock(_status_mutex);
+        if (not _status_cond.wait_for(lock, std::chrono::microseconds(timeoutUs),
+            [this, &status]{return _tx_status.pop(status);}))
+        {
+            return SOAPY_SDR_TIMEOUT;
+        }
+    }
+
+    chanMask = 1;
+    flags = status.flags;
+    timeNs = SoapySDR::ticksToTimeNs(status.tick, sampleRate);
+    return status.code;
+}
+
+int SoapyLoopback::setRxCallback(SoapySDR::Stream *stream, RxCallback callback, void *user)
+{
+    if (this->isTxStream(stream)) return SOAPY_SDR_NOT_SUPPORTED;
+    auto &rx = *reinterpret_cast<RxStream *>(stream);
+    if (not rx.ring->push) return SOAPY_SDR_NOT_SUPPORTED;
+
+    //the producer reads the callback without a lock
+    if (rx.active) return SOAPY_SDR_STREAM_ERROR;
+    rx.ring->callback = callback;
+    rx.ring->user = user;
+    return 0;
+}
+
+int SoapyLoopback::getRxEventFd(SoapySDR::Stream *stream) const
+{
+    if (this->isTxStream(stream)) return -1;
+    return reinterpret_cast<RxStream *>(stream)->ready.fd();
 }
 
 /*******************************************************************
@@ -336,12 +1850,23 @@ int SoapyLoopback::readStream(
 
 size_t SoapyLoopback::getNumDirectAccessBuffers(SoapySDR::Stream *stream)
 {
-    return _buffs.size();
+    if (this->isTxStream(stream)) return 0;
+
+    //the count stays as it is from here on, see acquireReadBuffer
+    auto &ring = *reinterpret_cast<RxStream *>(stream)->ring;
+    ring.direct = true;
+    return ring.buffs.size();
 }
 
 int SoapyLoopback::getDirectAccessBufferAddrs(SoapySDR::Stream *stream, const size_t handle, void **buffs)
 {
-    buffs[0] = (void *)_buffs[handle].data.data();
+    if (this->isTxStream(stream)) return SOAPY_SDR_NOT_SUPPORTED;
+    auto &ring = *reinterpret_cast<RxStream *>(stream)->ring;
+    auto &buff = ring.buffs[handle];
+    for (size_t i = 0; i < buff.data.size(); i++)
+    {
+        buffs[i] = (void *)(buff.zero ? ring.zeros.data() : buff.data[i].data());
+    }
     return 0;
 }
 
@@ -353,50 +1878,133 @@ int SoapyLoopback::acquireReadBuffer(
     long long &timeNs,
     const long timeoutUs)
 {
+    if (this->isTxStream(stream)) return SOAPY_SDR_NOT_SUPPORTED;
+
+    //direct access users keep the handles, so their ring stops adapting
+    auto &rx = *reinterpret_cast<RxStream *>(stream);
+    rx.ring->direct = true;
+    const long long lastTick = rx.bufTicks;
+    const int ret = this->acquireSlot(rx, handle, buffs, flags, timeNs, timeoutUs);
+    if (ret <= 0) return ret;
+
+    //the test pattern is checked in the format of the ring they get
+    this->checkPrbs(rx, *findEngine(SOAPY_SDR_CS8), buffs, ret, rx.bufTicks != lastTick);
+    rx.bufTicks += ret;
+
+    //and so are the levels, which the producer measured as it wrote the
+    //buffer; a zero buffer is silence, and one made before the stream
+    //turned to direct access was not measured
+    const bool zero = rx.bufZero;
+    for (size_t i = 0; i < rx.levels.size(); i++)
+    {
+        if (zero) rx.levels[i].add(LevelSums(), ret);
+        else if (i < rx.bufLevels.size()) rx.levels[i].add(rx.bufLevels[i], ret);
+    }
+    return ret;
+}
+
+int SoapyLoopback::acquireSlot(
+    RxStream &rx,
+    size_t &handle,
+    const void **buffs,
+    int &flags,
+    long long &timeNs,
+    const long timeoutUs)
+{
+    auto &ring = *rx.ring;
+    if (ring.push) return SOAPY_SDR_NOT_SUPPORTED;
+
+    std::unique_lock <std::mutex> lock(ring.mutex);
+
     //reset is issued by various settings
     //to drain old data out of the queue
-    if (resetBuffer)
+    if (rx.reset)
     {
-        //drain all buffers from the fifo
-        _buf_head = (_buf_head + _buf_count.exchange(0)) % numBuffers;
-        resetBuffer = false;
-        _overflowEvent = false;
+        //drain all buffers from the fifo, on purpose so not a gap,
+        //and look for the test pattern again
+        this->drainReader(rx);
+        rx.reset = false;
+        rx.overflow = false;
+        rx.seqValid = false;
+        for (auto &checker : rx.prbs) checker.resync();
     }
 
     //handle overflow from the rx callback thread
-    if (_overflowEvent)
+    if (rx.overflow)
     {
         //drain the old buffers from the fifo
-        _buf_head = (_buf_head + _buf_count.exchange(0)) % numBuffers;
-        _overflowEvent = false;
+        this->drainReader(rx);
+        rx.overflow = false;
+        lock.unlock();
+        this->notifyVirtualTime();
         SoapySDR::log(SOAPY_SDR_SSI, "O");
         return SOAPY_SDR_OVERFLOW;
     }
 
     //wait for a buffer to become available
-    if (_buf_count == 0)
+    if (rx.count == 0)
     {
-        std::unique_lock <std::mutex> lock(_buf_mutex);
-        _buf_cond.wait_for(lock, std::chrono::microseconds(timeoutUs), [this]{return _buf_count != 0;});
-        if (_buf_count == 0) return SOAPY_SDR_TIMEOUT;
+        //clear the ready descriptor before waiting, a buffer made
+        //from here on signals it again
+        rx.ready.clear();
+
+        //virtual time only passes as buffers are made, so the wait also
+        //ends early when the producer is held by something else, and the
+        //timeout still bounds it in wall time should nothing tell it so
+        if (virtualTime) rx.cond.wait_for(lock, std::chrono::microseconds(timeoutUs),
+            [this, &rx]{return rx.count != 0 or rx.stalled or not _rx_async_running;});
+        else rx.cond.wait_for(lock, std::chrono::microseconds(timeoutUs), [&rx]{return rx.count != 0;});
+        if (rx.count == 0) return SOAPY_SDR_TIMEOUT;
     }
 
-    //extract handle and buffer
-    handle = _buf_head;
-    _buf_head = (_buf_head + 1) % numBuffers;
-    bufTicks = _buffs[handle].tick;
-    timeNs = SoapySDR::ticksToTimeNs(_buffs[handle].tick, sampleRate);
-    buffs[0] = (void *)_buffs[handle].data.data();
+    //extract handle and buffer, it stays held until it is released
+    handle = rx.head;
+    rx.held.push_back(handle);
+    rx.head = (rx.head + 1) % ring.numBuffers;
+    rx.count--;
+    const auto &buff = ring.buffs[handle];
+    rx.bufTicks = buff.tick;
+    rx.bufZero = buff.zero;
+    if (buff.metered) rx.bufLevels = buff.levels;
+    else rx.bufLevels.clear();
+    timeNs = SoapySDR::ticksToTimeNs(buff.tick, sampleRate);
     flags = SOAPY_SDR_HAS_TIME;
 
+    //check the numbering, the ring hands out its slots in order so a
+    //number further on is a gap that ends the previous buffers abruptly;
+    //overflows leave gaps, resets and restarts do not
+    if (rx.seqValid and buff.seq != rx.nextSeq)
+    {
+        rx.gaps++;
+        rx.lost += buff.first - rx.nextFirst;
+        flags |= SOAPY_SDR_END_ABRUPT;
+    }
+    rx.nextSeq = buff.seq + 1;
+    rx.nextFirst = buff.first + buff.data[0].size() / BYTES_PER_SAMPLE;
+    rx.seqValid = true;
+
+    //a zero buffer hands out the shared zeros of the ring
+    for (size_t i = 0; i < buff.data.size(); i++)
+    {
+        buffs[i] = (void *)(buff.zero ? ring.zeros.data() : buff.data[i].data());
+    }
+
     //return number available
-    return _buffs[handle].data.size() / BYTES_PER_SAMPLE;
+    return buff.data[0].size() / BYTES_PER_SAMPLE;
 }
 
 void SoapyLoopback::releaseReadBuffer(
     SoapySDR::Stream *stream,
     const size_t handle)
 {
-    //TODO this wont handle out of order releases
-    _buf_count--;
+    //the slot is written again once every reader released it,
+    //in any order
+    auto &ring = *reinterpret_cast<RxStream *>(stream)->ring;
+    {
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        this->releaseSlot(*reinterpret_cast<RxStream *>(stream), handle);
+    }
+
+    //room in the ring moves virtual time on
+    this->notifyVirtualTime();
 }
@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Timebase.hpp"
+#include <map>
+#include <mutex>
+
+#define NS_PER_SECOND 1000000000LL
+
+SharedTimebase::SharedTimebase(void):
+    _epoch(std::chrono::steady_clock::now())
+{
+    return;
+}
+
+std::shared_ptr<SharedTimebase> SharedTimebase::get(const std::string &name)
+{
+    //a timebase lives as long as a device is locked to it
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<SharedTimebase>> timebases;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto timebase = timebases[name].lock();
+    if (not timebase)
+    {
+        timebase.reset(new SharedTimebase());
+        timebases[name] = timebase;
+    }
+    return timebase;
+}
+
+long long SharedTimebase::nowNs(void) const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _epoch).count();
+}
+
+std::chrono::steady_clock::time_point SharedTimebase::timeAt(const long long timeNs) const
+{
+    return _epoch + std::chrono::nanoseconds(timeNs);
+}
+
+long long SharedTimebase::nextPps(const long long timeNs)
+{
+    return (timeNs/NS_PER_SECOND + 1)*NS_PER_SECOND;
+}
+
+long long SharedTimebase::lastPps(const long long timeNs)
+{
+    return (timeNs/NS_PER_SECOND)*NS_PER_SECOND;
+}
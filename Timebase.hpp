@@ -0,0 +1,59 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+/*!
+ * A reference shared by the loopback devices of one process,
+ * standing in for a distributed 10 MHz reference and PPS line.
+ * Devices locked to the same timebase see the same clock, and its
+ * PPS edges fall on every whole second since the timebase was made.
+ */
+class SharedTimebase
+{
+public:
+    //! The timebase of this name, made on first use
+    static std::shared_ptr<SharedTimebase> get(const std::string &name);
+
+    //! Nanoseconds since the timebase was made
+    long long nowNs(void) const;
+
+    //! The steady clock time at a timebase time in nanoseconds
+    std::chrono::steady_clock::time_point timeAt(const long long timeNs) const;
+
+    //! The first PPS edge strictly after a timebase time
+    static long long nextPps(const long long timeNs);
+
+    //! The last PPS edge at or before a timebase time
+    static long long lastPps(const long long timeNs);
+
+private:
+    SharedTimebase(void);
+
+    const std::chrono::steady_clock::time_point _epoch;
+};
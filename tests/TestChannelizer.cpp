@@ -0,0 +1,60 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Channelizer.hpp"
+#include "TestCheck.hpp"
+#include "TestSignal.hpp"
+
+//a tone on the center of each channel comes out of that channel only
+static void testChannelizer(void)
+{
+    const size_t numChans = 8, numOut = 2048, settle = 64;
+    PolyphaseChannelizer channelizer;
+    channelizer.configure(numChans);
+    CHECK(channelizer.numChannels() == numChans);
+
+    for (size_t k = 0; k < numChans; k++)
+    {
+        channelizer.configure(numChans);
+        auto x = tone(double(k)/numChans, numOut*numChans);
+        std::vector<std::vector<std::complex<float> > > outs(numChans, std::vector<std::complex<float> >(numOut));
+        std::vector<std::complex<float> *> ptrs;
+        for (auto &out : outs) ptrs.push_back(out.data());
+        channelizer.process(x.data(), ptrs.data(), numOut);
+
+        const double wanted = power(outs[k].data() + settle, numOut - settle);
+        CHECK(wanted > 0.1);
+        for (size_t j = 0; j < numChans; j++)
+        {
+            if (j == k) continue;
+            CHECK(10*std::log10(power(outs[j].data() + settle, numOut - settle)/wanted) < -50.0);
+        }
+    }
+}
+
+int main(void)
+{
+    testChannelizer();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SoapyLoopback.hpp"
+#include "TestCheck.hpp"
+#include <SoapySDR/Formats.hpp>
+#include <SoapySDR/Time.hpp>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+
+//a gain step on the test pattern shows in the samples at its tick
+static SoapyLoopback *patternDevice(void)
+{
+    SoapySDR::Kwargs args;
+    args["virtual_time"] = "true";
+    auto *device = new SoapyLoopback(args);
+    device->writeSetting("prbs", "15");
+    device->writeSetting("impairments", "true");
+    device->setSampleRate(SOAPY_SDR_RX, 0, 1e6);
+    return device;
+}
+
+//a command keeps its time across a rate change that takes effect
+//before it: the gain queued for 100 ms steps at 100 ms at the new rate,
+//which takes effect on the first 4 ms buffer from 50 ms on
+static void testTimeAcrossRate(void)
+{
+    auto *device = patternDevice();
+    device->setCommandTime(100000000);
+    device->setGain(SOAPY_SDR_RX, 0, "TUNER", -20.0);
+    device->setCommandTime(50000000);
+    device->setSampleRate(SOAPY_SDR_RX, 0, 2e6);
+    device->setCommandTime(0);
+
+    SoapySDR::Kwargs args;
+    args["bufflen"] = "8192";
+    auto *stream = device->setupStream(SOAPY_SDR_RX, SOAPY_SDR_CS8, {0}, args);
+    device->activateStream(stream);
+    std::vector<signed char> buff(2*4096);
+    long long edgeNs = -1;
+    while (edgeNs < 0)
+    {
+        void *buffs[1] = {buff.data()};
+        int flags = 0;
+        long long timeNs = 0;
+        const int ret = device->readStream(stream, buffs, buff.size()/2, flags, timeNs, 1000000);
+        CHECK(ret > 0);
+        CHECK(timeNs < 200000000);
+        if (timeNs < 60000000) continue;
+        for (int i = 0; i < ret and edgeNs < 0; i++)
+        {
+            if (std::abs(buff[2*i]) < 32) edgeNs = timeNs + SoapySDR::ticksToTimeNs(i, 2e6);
+        }
+    }
+    CHECK(std::abs(edgeNs - 100000000) <= 500);
+    CHECK(device->getSampleRate(SOAPY_SDR_RX, 0) == 2e6);
+
+    device->deactivateStream(stream);
+    device->closeStream(stream);
+    delete device;
+}
+
+//a rate change waits for the next buffer, the commands due before
+//that do not wait with it: with the producer held at the end of the
+//ring, the gain due with the rate change applies and the rate does not
+static void testDueAheadOfRate(void)
+{
+    auto *device = patternDevice();
+    SoapySDR::Kwargs args;
+    args["bufflen"] = "8192";
+    args["buffers"] = "4";
+    auto *stream = device->setupStream(SOAPY_SDR_RX, SOAPY_SDR_CS8, {0}, args);
+
+    //the last buffer the ring has room for covers ticks 12288 to 16383
+    const long long now = device->getHardwareTime();
+    device->setCommandTime(now + SoapySDR::ticksToTimeNs(12388, 1e6));
+    device->setSampleRate(SOAPY_SDR_RX, 0, 2e6);
+    device->setGain(SOAPY_SDR_RX, 0, "TUNER", -20.0);
+    device->setCommandTime(0);
+
+    device->activateStream(stream);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(device->getGain(SOAPY_SDR_RX, 0, "TUNER") == -20.0);
+    CHECK(device->getSampleRate(SOAPY_SDR_RX, 0) == 1e6);
+
+    device->deactivateStream(stream);
+    device->closeStream(stream);
+    delete device;
+}
+
+int main(void)
+{
+    testTimeAcrossRate();
+    testDueAheadOfRate();
+    return EXIT_SUCCESS;
+}
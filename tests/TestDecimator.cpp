@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Decimator.hpp"
+#include "TestCheck.hpp"
+#include "TestSignal.hpp"
+
+//unity gain in the passband, the stopband attenuation outside of it,
+//and the same output in place or across calls
+static void testDecimator(void)
+{
+    const auto taps = FirDecimator::design(0.1, 0.05);
+    double sum = 0.0;
+    for (const auto h : taps) sum += h;
+    CHECK(std::abs(sum - 1.0) < 1e-4);
+    CHECK(taps.size() % 2 == 1);
+
+    const size_t decim = 4, numOut = 4096, settle = taps.size()/decim + 1;
+    FirDecimator decimator;
+    for (const double freq : {0.0, 0.02, -0.05})
+    {
+        decimator.configure(taps, decim);
+        auto x = tone(freq, numOut*decim);
+        std::vector<std::complex<float> > out(numOut);
+        decimator.process(x.data(), out.data(), numOut);
+        CHECK(std::abs(power(out.data() + settle, numOut - settle) - 1.0) < 1e-2);
+    }
+    for (const double freq : {0.2, -0.3, 0.45})
+    {
+        decimator.configure(taps, decim);
+        auto x = tone(freq, numOut*decim);
+        decimator.process(x.data(), x.data(), numOut);
+        CHECK(10*std::log10(power(x.data() + settle, numOut - settle)) < -70.0);
+    }
+
+    decimator.configure(taps, decim);
+    auto x = tone(0.013, numOut*decim);
+    std::vector<std::complex<float> > whole(numOut), split(numOut);
+    decimator.process(x.data(), whole.data(), numOut);
+    decimator.configure(taps, decim);
+    decimator.process(x.data(), split.data(), 1000);
+    decimator.process(x.data() + 1000*decim, split.data() + 1000, numOut - 1000);
+    for (size_t n = 0; n < numOut; n++) CHECK(std::abs(whole[n] - split[n]) < 1e-5f);
+}
+
+int main(void)
+{
+    testDecimator();
+    return EXIT_SUCCESS;
+}
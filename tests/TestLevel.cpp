@@ -0,0 +1,120 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Level.hpp"
+#include "TestCheck.hpp"
+#include <cmath>
+#include <cstdint>
+
+//window of the published levels
+static const size_t WINDOW = 65536;
+
+//sample k of a conversion loop, in groups of lanes as the loops go
+template <typename T>
+static void add(LevelAccumulator<T> &levels, const size_t k, const int xi, const int xq, const double yi, const double yq)
+{
+    levels.add(k % LEVEL_LANES, xi, xq, T(yi), T(yq));
+    if (k % LEVEL_LANES == LEVEL_LANES - 1) levels.next();
+}
+
+//a constant sample of magnitude a is a tone at 20*log10(a) dBFS,
+//and a full window is needed before anything is published
+static void testLevels(void)
+{
+    LevelMeter meter;
+    CHECK(std::isinf(meter.rmsDb()));
+    for (size_t n = 0; n < WINDOW; n += 4096)
+    {
+        LevelAccumulator<int16_t> levels(32767.0);
+        for (size_t k = 0; k < 4096; k++) add(levels, k, 0, 0, 16384, 0);
+        LevelSums sums;
+        levels.store(sums);
+        if (n == 0) CHECK(std::abs(sums.power/4096 - 0.25) < 1e-3);
+        CHECK(std::isinf(meter.rmsDb()));
+        meter.add(sums, 4096);
+    }
+    CHECK(std::abs(meter.rmsDb() + 6.02f) < 0.01f);
+    CHECK(std::abs(meter.peakDb() + 6.02f) < 0.01f);
+    CHECK(std::abs(meter.dcDb() + 6.02f) < 0.01f);
+    CHECK(meter.clips() == 0);
+    CHECK(meter.samples() == WINDOW);
+}
+
+//samples at full scale on I or Q are clipped in any word, the raw
+//sums stay in the units of the ring for the DC offset tracking
+static void testClips(void)
+{
+    LevelAccumulator<int8_t> ring(127.0);
+    ring.add(0, 127, 0, 127, 0);
+    ring.add(1, -127, 5, -127, 5);
+    ring.add(2, 3, 126, 3, 126);
+    LevelSums sums;
+    ring.store(sums);
+    CHECK(sums.clips == 2);
+    CHECK(sums.rawI == 127 - 127 + 3);
+    CHECK(sums.rawQ == 0 + 5 + 126);
+
+    LevelAccumulator<float> floats(1.0);
+    floats.add(0, 1, 1, 0.5f, -1.5f);
+    floats.add(1, 1, 1, 0.5f, 0.5f);
+    floats.store(sums);
+    CHECK(sums.clips == 1);
+    CHECK(std::abs(sums.peak - 2.5) < 1e-6);
+
+    //the clips add up from the start, not per window
+    LevelMeter meter;
+    for (int i = 0; i < 3; i++)
+    {
+        LevelAccumulator<int16_t> levels(2047.0);
+        for (size_t k = 0; k < WINDOW; k++) add(levels, k, 0, 0, (k % 2) ? 2047 : 0, 0);
+        levels.store(sums);
+        meter.add(sums, WINDOW);
+    }
+    CHECK(meter.clips() == 3*WINDOW/2);
+    CHECK(std::abs(meter.peakDb()) < 0.01f);
+    CHECK(std::abs(meter.rmsDb() + 3.01f) < 0.01f);
+}
+
+//the lanes fold before they overflow, here a full scale 16 bit
+//sample on I and Q where one lane would wrap in a few samples
+static void testFold(void)
+{
+    LevelAccumulator<int16_t> levels(32767.0);
+    const size_t numElems = 4*LEVEL_BLOCK + 5;
+    for (size_t k = 0; k < numElems; k++) add(levels, k, 0, 0, 32767, -32767);
+    LevelSums sums;
+    levels.store(sums);
+    CHECK(std::abs(sums.power/numElems - 2.0) < 1e-9);
+    CHECK(std::abs(sums.peak - 2.0) < 1e-9);
+    CHECK(std::abs(sums.sumI/numElems - 1.0) < 1e-9);
+    CHECK(sums.clips == numElems);
+}
+
+int main(void)
+{
+    testLevels();
+    testClips();
+    testFold();
+    return EXIT_SUCCESS;
+}
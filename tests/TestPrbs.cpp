@@ -0,0 +1,146 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Prbs.hpp"
+#include "TestCheck.hpp"
+#include <vector>
+
+static std::vector<float> pattern(const int order, const size_t numElems)
+{
+    PrbsGenerator gen;
+    gen.configure(order);
+    std::vector<std::complex<float> > samples(numElems);
+    gen.generate(samples.data(), numElems);
+    const float *x = reinterpret_cast<const float *>(samples.data());
+    return std::vector<float>(x, x + 2*numElems);
+}
+
+//a maximal length sequence repeats after 2^n - 1 bits and not before
+static void testPeriod(void)
+{
+    PrbsGenerator gen;
+    gen.configure(15);
+    CHECK(gen.order() == 15);
+    const size_t period = (1 << 15) - 1;
+    std::vector<uint64_t> bits(2*period);
+    for (auto &bit : bits) bit = gen.next(1);
+    for (size_t i = 0; i < period; i++) CHECK(bits[i] == bits[i + period]);
+    size_t same = 0;
+    for (size_t i = 0; i < period; i++) same += (bits[i] == bits[i + 1000]);
+    CHECK(same < period*3/4);
+
+    //chunks of bits give the same sequence as single ones
+    PrbsGenerator chunked;
+    chunked.configure(15);
+    for (size_t i = 0; i < period;)
+    {
+        const size_t n = std::min<size_t>(13, period - i);
+        const uint64_t word = chunked.next(n);
+        for (size_t j = 0; j < n; j++) CHECK(((word >> (n - 1 - j)) & 1) == bits[i + j]);
+        i += n;
+    }
+}
+
+//the checker locks on every order and counts no errors in a clean pattern
+static void testLock(void)
+{
+    for (const int order : {15, 23, 31})
+    {
+        const auto x = pattern(order, 100000);
+        PrbsChecker checker;
+        checker.configure(order);
+        CHECK(not checker.locked());
+        checker.check(x.data(), x.size()/2);
+        CHECK(checker.locked());
+        CHECK(checker.bits() > 190000);
+        CHECK(checker.errors() == 0);
+        CHECK(checker.slips() == 0);
+    }
+}
+
+//every sign that is flipped once locked is one error and no slip
+static void testErrors(void)
+{
+    auto x = pattern(23, 100000);
+    for (size_t i = 20000; i < x.size(); i += 997) x[i] = -x[i];
+    PrbsChecker checker;
+    checker.configure(23);
+    checker.check(x.data(), x.size()/2);
+    CHECK(checker.locked());
+    CHECK(checker.errors() == (x.size() - 20000 + 996)/997);
+    CHECK(checker.slips() == 0);
+}
+
+//samples cut out of the pattern are a slip, the checker finds the
+//sequence again; a resync after a known gap is not a slip
+static void testSlip(void)
+{
+    auto x = pattern(15, 200000);
+    x.erase(x.begin() + 100000, x.begin() + 100000 + 2*123);
+    PrbsChecker checker;
+    checker.configure(15);
+    checker.check(x.data(), x.size()/2);
+    CHECK(checker.slips() == 1);
+    CHECK(checker.locked());
+
+    const auto y = pattern(15, 200000);
+    PrbsChecker gap;
+    gap.configure(15);
+    gap.check(y.data(), 50000);
+    gap.resync();
+    gap.check(y.data() + 2*60000, 140000);
+    CHECK(gap.slips() == 0);
+    CHECK(gap.errors() == 0);
+    CHECK(gap.locked());
+}
+
+//the CS12 sign bits are found in their packed bytes
+static void testCheck12(void)
+{
+    const auto x = pattern(31, 50000);
+    std::vector<uint8_t> packed(3*50000);
+    for (size_t k = 0; k < 50000; k++)
+    {
+        const uint16_t i = uint16_t(int16_t(x[2*k+0]*2047));
+        const uint16_t q = uint16_t(int16_t(x[2*k+1]*2047));
+        packed[3*k+0] = uint8_t(i);
+        packed[3*k+1] = uint8_t(((i >> 8) & 0x0f) | (q << 4));
+        packed[3*k+2] = uint8_t(q >> 4);
+    }
+    PrbsChecker checker;
+    checker.configure(31);
+    checker.check12(packed.data(), 50000);
+    CHECK(checker.locked());
+    CHECK(checker.errors() == 0);
+}
+
+int main(void)
+{
+    testPeriod();
+    testLock();
+    testErrors();
+    testSlip();
+    testCheck12();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Replay.hpp"
+#include "TestCheck.hpp"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+static const char *PATH = "TestReplay.cap";
+
+//a stored CS16 capture: chunks of n samples on the given ticks,
+//each sample holds the index of its chunk and its position
+struct Capture
+{
+    ReplayHeader header;
+    std::vector<ReplayIndexEntry> index;
+    std::vector<std::vector<int16_t> > chunks;
+
+    Capture(const std::vector<long long> &ticks, const uint32_t numElems)
+    {
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "LBCAPTR1", 8);
+        header.format = REPLAY_CS16;
+        header.codec = REPLAY_STORED;
+        uint64_t offset = sizeof(header);
+        for (size_t i = 0; i < ticks.size(); i++)
+        {
+            ReplayIndexEntry entry;
+            entry.tick = ticks[i];
+            entry.offset = offset;
+            entry.bytes = numElems*4;
+            entry.numElems = numElems;
+            index.push_back(entry);
+            chunks.push_back(std::vector<int16_t>(2*numElems));
+            for (size_t k = 0; k < numElems; k++)
+            {
+                chunks.back()[2*k+0] = int16_t(i);
+                chunks.back()[2*k+1] = int16_t(k);
+            }
+            offset += entry.bytes;
+        }
+        header.indexOffset = offset;
+        header.numChunks = index.size();
+    }
+
+    void write(void) const
+    {
+        FILE *f = std::fopen(PATH, "wb");
+        CHECK(f != nullptr);
+        std::fwrite(&header, sizeof(header), 1, f);
+        for (const auto &chunk : chunks) std::fwrite(chunk.data(), 2, chunk.size(), f);
+        std::fwrite(index.data(), sizeof(ReplayIndexEntry), index.size(), f);
+        std::fclose(f);
+    }
+};
+
+static bool opens(const Capture &capture, const size_t maxElems = 4096)
+{
+    capture.write();
+    try
+    {
+        CaptureReplay replay(PATH, 2, 4, maxElems);
+        return true;
+    }
+    catch (const std::runtime_error &)
+    {
+        return false;
+    }
+}
+
+//the chunks come out in index order with their ticks and samples,
+//gaps between chunks included, whatever the number of threads
+static void testRoundTrip(void)
+{
+    const std::vector<long long> ticks = {1000, 2024, 5000, 6024, 7048, 9000, 10024, 20000, 21024, 22048};
+    const Capture capture(ticks, 1024);
+    capture.write();
+    for (const size_t threads : {1, 3})
+    {
+        CaptureReplay replay(PATH, threads, 4, 1024);
+        CHECK(replay.format() == REPLAY_CS16);
+        CHECK(replay.firstTick() == 1000);
+        for (size_t i = 0; i < ticks.size(); i++)
+        {
+            const ReplayChunk *chunk = replay.front(1000000);
+            CHECK(chunk != nullptr);
+            CHECK(chunk->tick == ticks[i]);
+            CHECK(chunk->numElems == 1024);
+            CHECK(std::memcmp(chunk->data.data(), capture.chunks[i].data(), 4*1024) == 0);
+            replay.pop();
+        }
+        CHECK(replay.front(1000) == nullptr);
+        CHECK(replay.finished());
+        CHECK(replay.errors() == 0);
+    }
+}
+
+//a broken header or index is refused when the capture is opened
+static void testIndexValidation(void)
+{
+    const Capture good({0, 100, 200}, 100);
+    CHECK(opens(good));
+    CHECK(not opens(good, 99));
+
+    Capture magic = good;
+    magic.header.magic[7] = '2';
+    CHECK(not opens(magic));
+
+    Capture format = good;
+    format.header.format = 7;
+    CHECK(not opens(format));
+
+    Capture past = good;
+    past.header.numChunks = 4;
+    CHECK(not opens(past));
+
+    Capture overlap = good;
+    overlap.index[2].tick = 150;
+    CHECK(not opens(overlap));
+
+    Capture size = good;
+    size.index[1].bytes = 396;
+    CHECK(not opens(size));
+
+    //a chunk that cannot be read plays as an empty one
+    Capture lost = good;
+    lost.index[1].offset = 1 << 30;
+    lost.write();
+    CaptureReplay replay(PATH, 1, 2, 100);
+    for (size_t i = 0; i < 3; i++)
+    {
+        const ReplayChunk *chunk = replay.front(1000000);
+        CHECK(chunk != nullptr);
+        CHECK(chunk->numElems == ((i == 1) ? 0 : 100));
+        replay.pop();
+    }
+    CHECK(replay.errors() == 1);
+}
+
+int main(void)
+{
+    testRoundTrip();
+    testIndexValidation();
+    std::remove(PATH);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Resampler.hpp"
+#include "TestCheck.hpp"
+#include <cmath>
+
+//the cubic interpolation is exact on a ramp, so the outputs step by the
+//resampling step across calls, a new step taking over after the first
+static void testResampler(void)
+{
+    FarrowResampler resampler;
+    double x = 0.0, previous = 1.0;
+    std::vector<std::complex<float> > out;
+    float last = 0.0f;
+    size_t count = 0;
+    for (const double step : {1.0, 0.5, 1.25, 0.999, 1.001, 2.0})
+    {
+        for (size_t call = 0; call < 4; call++)
+        {
+            const size_t numOut = 1000 + 37*call;
+            std::vector<std::complex<float> > in(resampler.inputsNeeded(numOut, step));
+            for (auto &v : in) v = std::complex<float>(float(x++), 0.0f);
+            out.resize(numOut);
+            resampler.process(in.data(), out.data(), numOut, step);
+            for (size_t n = 0; n < numOut; n++, count++)
+            {
+                const double expected = (n == 0) ? previous : step;
+                if (count > 4) CHECK(std::abs(out[n].real() - last - expected) < 1e-2);
+                last = out[n].real();
+            }
+            previous = step;
+        }
+    }
+
+    //a reset starts over like a new resampler
+    resampler.reset();
+    FarrowResampler fresh;
+    std::vector<std::complex<float> > in(resampler.inputsNeeded(64, 0.75));
+    for (auto &v : in) v = std::complex<float>(float(x++), 1.0f);
+    std::vector<std::complex<float> > other(64);
+    out.resize(64);
+    resampler.process(in.data(), out.data(), 64, 0.75);
+    fresh.process(in.data(), other.data(), 64, 0.75);
+    for (size_t n = 0; n < 64; n++) CHECK(out[n] == other[n]);
+}
+
+int main(void)
+{
+    testResampler();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SoapyLoopback.hpp"
+#include "TestCheck.hpp"
+#include <SoapySDR/Formats.hpp>
+#include <SoapySDR/Time.hpp>
+#include <chrono>
+#include <thread>
+#include <string>
+
+static const double RATE = 4e6;
+
+static unsigned long long sensor(SoapyLoopback &device, const std::string &name)
+{
+    return std::stoull(device.readSensor(SOAPY_SDR_RX, 0, name));
+}
+
+//in virtual time nothing is lost, even while the reader stalls
+//in wall time: the buffers follow each other
+//tick for tick and the numbering has no gaps
+static void testContiguous(void)
+{
+    SoapySDR::Kwargs args;
+    args["virtual_time"] = "true";
+    SoapyLoopback device(args);
+    device.setSampleRate(SOAPY_SDR_RX, 0, RATE);
+    auto *stream = device.setupStream(SOAPY_SDR_RX, SOAPY_SDR_CF32, {0});
+    device.activateStream(stream);
+
+    std::vector<std::complex<float> > buff(3000);
+    long long next = -1, total = 0;
+    bool stalled = false;
+    while (total < 1000000)
+    {
+        if (not stalled and total > 500000)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            stalled = true;
+        }
+        void *buffs[1] = {buff.data()};
+        int flags = 0;
+        long long timeNs = 0;
+        const int ret = device.readStream(stream, buffs, buff.size(), flags, timeNs, 1000000);
+        CHECK(ret > 0);
+        CHECK((flags & SOAPY_SDR_END_ABRUPT) == 0);
+        const long long tick = SoapySDR::timeNsToTicks(timeNs, RATE);
+        if (next >= 0) CHECK(tick == next);
+        next = tick + ret;
+        total += ret;
+    }
+    CHECK(sensor(device, "seq_gaps") == 0);
+    CHECK(sensor(device, "seq_lost") == 0);
+    device.deactivateStream(stream);
+    device.closeStream(stream);
+}
+
+//a buffer a reader holds is parked when the ring comes around to it:
+//the reader that keeps up loses nothing, the one that holds on
+//overflows on its own backlog and sees that as one gap, ending the
+//buffer before it abruptly
+static void testHeldBuffer(void)
+{
+    SoapyLoopback device(SoapySDR::Kwargs{});
+    device.setSampleRate(SOAPY_SDR_RX, 0, RATE);
+    SoapySDR::Kwargs args;
+    args["bufflen"] = "65536";
+    args["buffers"] = "8";
+    auto *fast = device.setupStream(SOAPY_SDR_RX, SOAPY_SDR_CS8, {0}, args);
+    SoapySDR::Kwargs attach;
+    attach["attach"] = "true";
+    auto *slow = device.setupStream(SOAPY_SDR_RX, SOAPY_SDR_CS8, {0}, attach);
+    device.activateStream(fast);
+    device.activateStream(slow);
+
+    size_t held = 0;
+    const void *buffs[1];
+    int flags = 0;
+    long long timeNs = 0;
+    CHECK(device.acquireReadBuffer(slow, held, buffs, flags, timeNs, 1000000) > 0);
+
+    long long next = -1;
+    const auto start = std::chrono::steady_clock::now();
+    bool holding = true;
+    while (std::chrono::steady_clock::now() < start + std::chrono::milliseconds(400))
+    {
+        if (holding and std::chrono::steady_clock::now() > start + std::chrono::milliseconds(200))
+        {
+            device.releaseReadBuffer(slow, held);
+            holding = false;
+        }
+        size_t handle = 0;
+        flags = 0;
+        const int ret = device.acquireReadBuffer(fast, handle, buffs, flags, timeNs, 1000000);
+        CHECK(ret > 0);
+        CHECK((flags & SOAPY_SDR_END_ABRUPT) == 0);
+        const long long tick = SoapySDR::timeNsToTicks(timeNs, RATE);
+        if (next >= 0) CHECK(tick == next);
+        next = tick + ret;
+        device.releaseReadBuffer(fast, handle);
+    }
+    CHECK(sensor(device, "seq_gaps") == 0);
+
+    //the reader that held on is told of its overflow once,
+    //and the buffers it missed are one gap
+    size_t handle = 0;
+    CHECK(device.acquireReadBuffer(slow, handle, buffs, flags, timeNs, 1000000) == SOAPY_SDR_OVERFLOW);
+    flags = 0;
+    CHECK(device.acquireReadBuffer(slow, handle, buffs, flags, timeNs, 1000000) > 0);
+    CHECK((flags & SOAPY_SDR_END_ABRUPT) != 0);
+    device.releaseReadBuffer(slow, handle);
+    CHECK(sensor(device, "seq_gaps") == 1);
+    CHECK(sensor(device, "seq_lost") > 0);
+
+    device.deactivateStream(slow);
+    device.deactivateStream(fast);
+    device.closeStream(slow);
+    device.closeStream(fast);
+}
+
+int main(void)
+{
+    testContiguous();
+    testHeldBuffer();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+/*
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2021 Julia Computing, Inc.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <complex>
+#include <vector>
+#include <cmath>
+
+//a unit tone at a frequency normalized to the sample rate
+static inline std::vector<std::complex<float> > tone(const double freq, const size_t numElems)
+{
+    std::vector<std::complex<float> > out(numElems);
+    for (size_t n = 0; n < numElems; n++) out[n] = std::polar(1.0f, float(2*M_PI*freq*n));
+    return out;
+}
+
+//mean power of the samples
+static inline double power(const std::complex<float> *x, const size_t numElems)
+{
+    double sum = 0.0;
+    for (size_t n = 0; n < numElems; n++) sum += std::norm(x[n]);
+    return sum/numElems;
+}